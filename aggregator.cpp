@@ -0,0 +1,620 @@
+#include "aggregator.h"
+
+#include <atomic>
+#include <barrier>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+#include <fmt/core.h>
+
+#include "compressed_input.h"
+#include "delimiter_scanner.h"
+#include "memory_input.h"
+#include "numa_topology.h"
+#include "pread_file.h"
+#include "snapshot.h"
+#include "work_scheduler.h"
+
+namespace {
+
+/**
+ * Reader which adds the time spent in get_chunk_for_offset to the input time of a thread.
+ */
+template<typename Reader>
+class timed_reader {
+public:
+    timed_reader(Reader & reader, thread_stats & stats) : reader_{reader}, stats_{stats} {
+    }
+
+    auto get_chunk_for_offset(size_t off, size_t until) {
+        auto const start = stats_clock::now();
+        auto chunk = reader_.get_chunk_for_offset(off, until);
+        stats_.input_s_ += seconds_since(start);
+        return chunk;
+    }
+
+private:
+    Reader & reader_;
+    thread_stats & stats_;
+};
+
+/**
+ * Run thread_cnt threads which call scan(thread_nr, local_result) to fill
+ * their own table. After all threads are done scanning, thread n merges
+ * shard n (a disjoint part of the key space) of all local tables into its
+ * shard of the result; no locks needed.
+ * If stats is not null, the time of the phases, rows, page faults and hardware
+ * counters of every thread are recorded; scan adds the input time and bytes.
+ * If placement is not null, every thread is pinned to its CPU and allocates
+ * its tables there. With several NUMA nodes the threads of a node first merge
+ * their tables into node tables the same way, so the global merge only reads
+ * one table per node and key instead of one per thread.
+ * @return the aggregated values, split into shards with disjoint keys
+ * @throw the first exception thrown by scan after all threads are finished
+ */
+template<typename Scan>
+auto run_workers(size_t thread_cnt, Scan scan, run_stats * stats, thread_placement const * placement = nullptr) -> std::vector<agg_map_type> {
+    std::vector<std::jthread> threads;
+    std::vector<std::future<void>> futures;
+    std::vector<agg_map_type> local_results(thread_cnt);
+    std::vector<agg_map_type> node_results(thread_cnt);
+    std::vector<agg_map_type> aggregated_result(thread_cnt);
+    std::barrier scan_done(static_cast<std::ptrdiff_t>(thread_cnt));
+    std::barrier node_merge_done(static_cast<std::ptrdiff_t>(thread_cnt));
+    bool const merge_nodes = placement && placement->nodes_ > 1;
+    std::vector<std::vector<size_t>> node_threads;
+    if (merge_nodes) {
+        for (size_t node = 0; node < placement->nodes_; ++node)
+            node_threads.push_back(placement->threads_of(node));
+    }
+    if (stats)
+        stats->threads_.assign(thread_cnt, thread_stats{});
+
+    for(size_t thread_nr = 0; thread_nr < thread_cnt; ++thread_nr) {
+        std::promise<void> prm;
+        futures.push_back(prm.get_future());
+        threads.emplace_back([&local_results, &node_results, &aggregated_result, &scan_done, &node_merge_done, &scan, &node_threads,
+                              stats, placement, merge_nodes, promise=std::move(prm), thread_nr, thread_cnt] () mutable {
+            if (placement) {
+                numa_topology::pin_current_thread(placement->cpu_of_thread_[thread_nr]);
+                // reallocate the tables on the thread's node (first touch)
+                local_results[thread_nr] = agg_map_type{};
+                node_results[thread_nr] = agg_map_type{};
+                aggregated_result[thread_nr] = agg_map_type{};
+            }
+            thread_stats * ts = stats ? &stats->threads_[thread_nr] : nullptr;
+            std::optional<thread_stats_recorder> recorder;
+            if (ts)
+                recorder.emplace(*ts);
+            auto const scan_start = stats_clock::now();
+            std::exception_ptr error;
+            try {
+                scan(thread_nr, local_results[thread_nr]);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            auto const scan_end = stats_clock::now();
+            scan_done.arrive_and_wait();
+            auto const merge_start = stats_clock::now();
+            auto const * sources = &local_results;
+            if (merge_nodes) {
+                auto const & peers = node_threads[placement->node_of_thread_[thread_nr]];
+                auto const shard = static_cast<size_t>(std::find(peers.begin(), peers.end(), thread_nr) - peers.begin());
+                for (auto const peer : peers)
+                    node_results[thread_nr].merge_shard(local_results[peer], shard, peers.size());
+                node_merge_done.arrive_and_wait();
+                sources = &node_results;
+            }
+            // every thread has seen most of the keys; presize the shard to avoid growing it
+            size_t max_local_size = 0;
+            for (auto const & local_result : local_results)
+                max_local_size = std::max(max_local_size, local_result.size());
+            aggregated_result[thread_nr].reserve(max_local_size / thread_cnt * 5 / 4);
+            for (auto const & source : *sources)
+                aggregated_result[thread_nr].merge_shard(source, thread_nr, thread_cnt);
+            if (ts) {
+                ts->scan_s_ = std::chrono::duration<double>(scan_end - scan_start).count() - ts->input_s_;
+                ts->wait_s_ = std::chrono::duration<double>(merge_start - scan_end).count();
+                ts->merge_s_ = seconds_since(merge_start);
+                for (auto const & e : local_results[thread_nr].table())
+                    ts->rows_ += e.value_.cnt_;
+                recorder.reset();
+            }
+            if (error)
+                promise.set_exception(error);
+            else
+                promise.set_value();
+        });
+    }
+    std::exception_ptr error;
+    for(auto & e : futures) {
+        try {
+            e.get();
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    if (error)
+        std::rethrow_exception(error);
+    return aggregated_result;
+}
+
+/**
+ * aggregate the lines of the input from begin to end with multiple threads
+ * @tparam Input mmapped_file, pread_file or memory_input
+ * @param begin 0 or the offset behind a new-line
+ * @param end offset behind the last byte to process, usually the file size
+ */
+template<typename Input>
+auto aggregate_file(Input const & input, size_t begin, size_t end, aggregator_options const & options) -> std::vector<agg_map_type> {
+    bool const verbose = options.verbose_;
+    size_t range_size = options.range_size_.value_or(work_scheduler::suggest_range_size(
+        end - begin, options.threads_, 1 << 20, input.chunk_size()));
+    auto const ranges_total = work_scheduler(begin, end, range_size, mmapped_file::page_size()).ranges_total();
+    auto thread_cnt = std::max<size_t>(1, std::min(ranges_total, options.threads_));
+    std::optional<thread_placement> placement;
+    if (options.pin_threads_)
+        placement.emplace(numa_topology::detect(), thread_cnt);
+    // one scheduler per node for a contiguous part of the file in proportion to its threads;
+    // a thread takes the ranges of its own node first and helps the other nodes afterwards
+    size_t const nodes = placement ? placement->nodes_ : 1;
+    std::vector<std::unique_ptr<work_scheduler>> schedulers;
+    for (size_t node = 0, first_thread = 0; node < nodes; ++node) {
+        size_t const next_thread = placement ? first_thread + placement->threads_of(node).size() : thread_cnt;
+        schedulers.push_back(std::make_unique<work_scheduler>(begin + (end - begin) * first_thread / thread_cnt,
+            begin + (end - begin) * next_thread / thread_cnt, range_size, mmapped_file::page_size()));
+        first_thread = next_thread;
+    }
+    if (verbose){
+        fmt::println(stderr, "Using chunk size of {}.", input.chunk_size());
+        fmt::println(stderr, "File has size {}.", input.file_size());
+        if (begin > 0 || end < input.file_size())
+            fmt::println(stderr, "Processing bytes {} to {}.", begin, end);
+        fmt::println(stderr, "Using {} ranges of {} bytes.", ranges_total, schedulers.front()->range_size());
+        fmt::println(stderr, "Using {} threads.", thread_cnt);
+        if (placement)
+            fmt::println(stderr, "Pinning the threads to {} NUMA node(s).", nodes);
+        fmt::println(stderr, "Using {} delimiter kernel.", active_delimiter_kernel_name());
+    }
+
+    auto * stats = options.stats_;
+    auto const scan_opts = options.scan_;
+    thread_placement const * where = placement ? &*placement : nullptr;
+    return run_workers(thread_cnt, [&input, &schedulers, where, verbose, stats, scan_opts](size_t thread_nr, agg_map_type & local_result) {
+        size_t const home = where ? where->node_of_thread_[thread_nr] : 0;
+        auto scan_ranges = [&](auto & reader) {
+            for (size_t i = 0; i < schedulers.size(); ++i) {
+                auto & scheduler = *schedulers[(home + i) % schedulers.size()];
+                while (auto range = scheduler.next()) {
+                    if (verbose)
+                        fmt::println(stderr, "Partition {:02} from {:9L} to {:9L}", range->nr_, range->start_, range->end_);
+                    scan_input(reader, range->start_, range->end_, local_result, range->nr_, verbose, scan_opts);
+                    if (stats)
+                        stats->threads_[thread_nr].bytes_ += range->end_ - range->start_;
+                }
+            }
+        };
+        auto && reader = input.chunk_reader();
+        if (stats) {
+            timed_reader timed(reader, stats->threads_[thread_nr]);
+            scan_ranges(timed);
+        } else {
+            scan_ranges(reader);
+        }
+    }, stats, where);
+}
+
+/**
+ * aggregate a stream which need not be seekable: the calling thread reads
+ * blocks of complete lines which are scanned by a pool of threads
+ */
+auto aggregate_stream(read_function source, std::string const & name, aggregator_options const & options) -> std::vector<agg_map_type> {
+    auto thread_cnt = std::max<size_t>(1, options.threads_);
+    if (options.verbose_) {
+        fmt::println(stderr, "Streaming {} in blocks of {} bytes.", name, stream_input::DEFAULT_BLOCK_SIZE);
+        fmt::println(stderr, "Using {} threads.", thread_cnt);
+        fmt::println(stderr, "Using {} delimiter kernel.", active_delimiter_kernel_name());
+    }
+    stream_input input(std::move(source), name, 2 * thread_cnt);
+    std::exception_ptr read_error;
+    std::jthread reader([&input, &read_error] {
+        try {
+            input.read_all();
+        } catch (...) {
+            read_error = std::current_exception();
+        }
+    });
+    auto * stats = options.stats_;
+    auto const scan_opts = options.scan_;
+    std::optional<thread_placement> placement;
+    if (options.pin_threads_)
+        placement.emplace(numa_topology::detect(), thread_cnt);
+    std::vector<agg_map_type> result;
+    try {
+        result = run_workers(thread_cnt, [&input, stats, scan_opts](size_t thread_nr, agg_map_type & local_result) {
+            try {
+                while (true) {
+                    auto const start = stats_clock::now();
+                    auto block = input.next();
+                    if (stats)
+                        stats->threads_[thread_nr].input_s_ += seconds_since(start);
+                    if (!block)
+                        break;
+                    scan_lines(block->string_view(), 0, block->offset_, std::numeric_limits<size_t>::max(), local_result, scan_opts);
+                    if (stats)
+                        stats->threads_[thread_nr].bytes_ += block->len_;
+                    input.recycle(std::move(*block));
+                }
+            } catch (...) {
+                input.cancel();
+                throw;
+            }
+        }, stats, placement ? &*placement : nullptr);
+    } catch (...) {
+        reader.join();
+        throw;
+    }
+    reader.join();
+    if (read_error)
+        std::rethrow_exception(read_error);
+    return result;
+}
+
+/**
+ * the partial lines at both ends of the decompressed content of a frame
+ */
+struct frame_edges {
+    std::string head_;        // up to the first new-line
+    std::string tail_;        // behind the last new-line
+    bool has_newline_{false}; // otherwise head_ is the whole content
+    size_t size_{0};          // size of the decompressed content
+};
+
+/**
+ * scan the complete lines of a decompressed frame
+ * @param frame_offset offset of the decompressed frame in the decompressed input; used for error messages
+ * @return the partial lines at both ends, which are completed by the neighbouring frames
+ */
+auto scan_frame(std::string_view frame, size_t frame_offset, std::vector<char> & buffer, agg_map_type & map,
+                scan_options const & scan_opts) -> frame_edges {
+    frame_edges edges;
+    zstd_decoder decoder(frame);
+    size_t filled = 0;
+    size_t offset = frame_offset; // offset of buffer[0] in the decompressed input
+    bool eof = false;
+    while (!eof) {
+        if (filled == buffer.size())
+            buffer.resize(2 * buffer.size());
+        auto const n = decoder.read(buffer.data() + filled, buffer.size() - filled);
+        eof = n == 0;
+        filled += n;
+        std::string_view sv(buffer.data(), filled);
+        size_t pos = 0;
+        if (!edges.has_newline_) {
+            auto const nl = sv.find(u8'\n');
+            if (nl == std::string_view::npos) {
+                if (eof)
+                    edges.head_ = sv;
+                continue;
+            }
+            edges.head_ = sv.substr(0, nl);
+            edges.has_newline_ = true;
+            pos = nl + 1;
+        }
+        auto const last_nl = sv.rfind(u8'\n');
+        if (last_nl >= pos && last_nl != std::string_view::npos)
+            pos = scan_lines(sv.substr(0, last_nl + 1), pos, offset, std::numeric_limits<size_t>::max(), map, scan_opts);
+        if (eof) {
+            edges.tail_ = sv.substr(pos);
+            edges.size_ = offset + filled - frame_offset;
+        } else {
+            std::memmove(buffer.data(), buffer.data() + pos, filled - pos);
+            filled -= pos;
+            offset += pos;
+        }
+    }
+    return edges;
+}
+
+/**
+ * @return the offsets of the decompressed frames in the decompressed data, or nothing if a frame does not
+ * declare the size of its content
+ */
+auto zstd_frame_offsets(std::vector<std::string_view> const & frames) -> std::optional<std::vector<size_t>> {
+    std::vector<size_t> offsets;
+    size_t offset = 0;
+    for (auto const frame : frames) {
+        offsets.push_back(offset);
+        auto const size = ZSTD_getFrameContentSize(frame.data(), frame.size());
+        if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR)
+            return {};
+        offset += size;
+    }
+    return offsets;
+}
+
+/**
+ * aggregate zstd compressed data consisting of independent frames: the
+ * threads decompress and scan one frame after another; finally the lines
+ * crossing frame boundaries are put together and added.
+ * The offsets of format errors are those in the decompressed data if all
+ * frames declare the size of their content (as zstd does for files), and
+ * offsets within the decompressed frame named in the message otherwise.
+ */
+auto aggregate_zstd_frames(std::vector<std::string_view> const & frames, aggregator_options const & options) -> std::vector<agg_map_type> {
+    work_scheduler scheduler(0, frames.size(), 1);
+    auto thread_cnt = std::max<size_t>(1, std::min(frames.size(), options.threads_));
+    if (options.verbose_) {
+        fmt::println(stderr, "Decompressing {} zstd frames.", frames.size());
+        fmt::println(stderr, "Using {} threads.", thread_cnt);
+        fmt::println(stderr, "Using {} delimiter kernel.", active_delimiter_kernel_name());
+    }
+    std::vector<frame_edges> edges(frames.size());
+    auto * stats = options.stats_;
+    auto const scan_opts = options.scan_;
+    std::optional<thread_placement> placement;
+    if (options.pin_threads_)
+        placement.emplace(numa_topology::detect(), thread_cnt);
+    auto const offsets = zstd_frame_offsets(frames);
+    auto result = run_workers(thread_cnt, [&frames, &offsets, &scheduler, &edges, stats, scan_opts](size_t thread_nr, agg_map_type & local_result) {
+        std::vector<char> buffer(stream_input::DEFAULT_BLOCK_SIZE);
+        while (auto range = scheduler.next()) {
+            auto const frame_nr = range->nr_;
+            try {
+                edges[frame_nr] = scan_frame(frames[frame_nr], offsets ? (*offsets)[frame_nr] : 0, buffer, local_result, scan_opts);
+            } catch (format_error const & e) {
+                if (offsets)
+                    throw;
+                throw format_error(fmt::format("{} of zstd frame {}", e.what(), frame_nr));
+            }
+            if (stats)
+                stats->threads_[thread_nr].bytes_ += edges[frame_nr].size_;
+        }
+    }, stats, placement ? &*placement : nullptr);
+    // now that the sizes of all frames are known, every line crossing frame boundaries is added with its offset
+    agg_map_type stitched;
+    std::string carry;
+    size_t carry_offset = 0; // offset of carry in the decompressed data
+    size_t frame_offset = 0;
+    for (auto const & e : edges) {
+        carry += e.head_;
+        if (e.has_newline_) {
+            carry += '\n';
+            scan_lines(carry, 0, carry_offset, std::numeric_limits<size_t>::max(), stitched, scan_opts);
+            carry = e.tail_;
+            carry_offset = frame_offset + e.size_ - e.tail_.size();
+        }
+        frame_offset += e.size_;
+    }
+    if (!carry.empty()) {
+        carry += '\n';
+        scan_lines(carry, 0, carry_offset, std::numeric_limits<size_t>::max(), stitched, scan_opts);
+    }
+    for (size_t shard = 0; shard < result.size(); ++shard)
+        result[shard].merge_shard(stitched, shard, result.size());
+    return result;
+}
+
+/**
+ * aggregate a compressed file; frames of zstd files are decompressed in parallel
+ */
+auto aggregate_compressed_file(std::string const & file_name, compression c, aggregator_options const & options) -> std::vector<agg_map_type> {
+    if (c == compression::zstd) {
+        mmapped_file input(file_name, options.chunk_size_.value_or(1 << 26), mapping_options{mapping_strategy::whole_file});
+        if (!input)
+            throw std::runtime_error("Cannot open " + file_name);
+        // the frames are found in the whole file, which may be larger than a chunk
+        auto const whole_file = input.get_whole_file();
+        auto const data = whole_file.string_view();
+        auto const frames = zstd_frames(data);
+        if (frames.size() > 1 && options.threads_ > 1)
+            return aggregate_zstd_frames(frames, options);
+        return aggregate_stream([decoder = std::make_shared<zstd_decoder>(data)](char *buf, size_t len) {
+            return decoder->read(buf, len);
+        }, file_name, options);
+    }
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror(file_name.c_str());
+        throw std::runtime_error("Cannot open " + file_name);
+    }
+    try {
+        auto result = aggregate_stream(decompressing_read_function(c, fd_read_function(fd, file_name)), file_name, options);
+        close(fd);
+        return result;
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+}
+
+/**
+ * aggregate the lines from begin to end of a regular uncompressed file with the configured backend
+ */
+auto aggregate_regular_file(std::string const & file_name, size_t begin, std::optional<size_t> end,
+                            aggregator_options const & options) -> std::vector<agg_map_type> {
+    auto const start = stats_clock::now();
+    auto run = [&](auto const & input) {
+        if (!input)
+            throw std::runtime_error("Cannot open " + file_name);
+        if (options.stats_)
+            options.stats_->open_s_ = seconds_since(start);
+        return aggregate_file(input, begin, end.value_or(input.file_size()), options);
+    };
+    if (options.io_ == io_backend::pread) {
+        pread_file input(file_name, options.chunk_size_.value_or(1 << 23), options.direct_);
+        if (options.verbose_)
+            fmt::println(stderr, "Using pread{}.", input.direct() ? " with O_DIRECT" : "");
+        return run(input);
+    }
+    mmapped_file input(file_name, options.chunk_size_.value_or(1 << 26), options.mapping_);
+    if (options.verbose_)
+        fmt::println(stderr, "Using {} mapping.", input.strategy_name());
+    return run(input);
+}
+
+/**
+ * @param begin, end the part of the file
+ * @param end_of_lines set to the offset behind the last new-line from begin to end, or begin if there is none
+ * @return the last line from begin to end if it does not end with a new-line
+ */
+auto unterminated_line(std::string const & file_name, size_t begin, size_t end, size_t & end_of_lines) -> std::string {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror(file_name.c_str());
+        throw std::runtime_error("Cannot open " + file_name);
+    }
+    std::string line;
+    try {
+        end_of_lines = std::max<size_t>(begin, snapshot::end_of_lines(fd, end));
+        line.resize(end - end_of_lines);
+        size_t done = 0;
+        while (done < line.size()) {
+            auto const n = pread(fd, line.data() + done, line.size() - done, static_cast<off_t>(end_of_lines + done));
+            if (n <= 0)
+                throw std::runtime_error("Cannot read " + file_name);
+            done += static_cast<size_t>(n);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return line;
+}
+
+} // namespace
+
+aggregator::aggregator(aggregator_options options) : options_{std::move(options)} {
+    options_.threads_ = std::max<size_t>(1, options_.threads_);
+    if (options_.scan_.columns_ < 1 || options_.scan_.columns_ > scan_options::MAX_COLUMNS)
+        throw std::invalid_argument(fmt::format("Cannot aggregate {} value columns", options_.scan_.columns_));
+    if (options_.scan_.filter_ && options_.scan_.filter_->columns() > options_.scan_.columns_)
+        throw std::invalid_argument(fmt::format("Cannot filter value column {} of {}", options_.scan_.filter_->columns(), options_.scan_.columns_));
+}
+
+void aggregator::add_file(std::string const & file_name) {
+    if (file_name == "-" || !std::filesystem::is_regular_file(file_name)) {
+        int fd = file_name == "-" ? STDIN_FILENO : open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            perror(file_name.c_str());
+            throw std::runtime_error("Cannot open " + file_name);
+        }
+        std::string const name = file_name == "-" ? "stdin" : file_name;
+        try {
+            add_stream(fd_read_function(fd, name), name);
+        } catch (...) {
+            if (fd != STDIN_FILENO)
+                close(fd);
+            throw;
+        }
+        if (fd != STDIN_FILENO)
+            close(fd);
+        return;
+    }
+    if (auto c = file_compression(file_name); c != compression::none) {
+        if (options_.verbose_)
+            fmt::println(stderr, "Reading {} with {} compression.", file_name, compression_name(c));
+        auto const start = stats_clock::now();
+        add(aggregate_compressed_file(file_name, c, options_));
+        if (options_.stats_)
+            options_.stats_->aggregate_s_ = seconds_since(start);
+        return;
+    }
+    add_file(file_name, 0, std::filesystem::file_size(file_name));
+}
+
+void aggregator::add_file(std::string const & file_name, size_t begin, size_t end) {
+    // a last line without new-line is added on its own; scan_input() only handles complete lines
+    size_t end_of_lines = begin;
+    auto const last_line = unterminated_line(file_name, begin, end, end_of_lines);
+    auto const start = stats_clock::now();
+    add(aggregate_regular_file(file_name, begin, end_of_lines, options_));
+    if (options_.stats_)
+        options_.stats_->aggregate_s_ = seconds_since(start) - options_.stats_->open_s_;
+    if (!last_line.empty()) {
+        agg_map_type stations;
+        scan_lines(last_line + '\n', 0, end_of_lines, std::numeric_limits<size_t>::max(), stations, options_.scan_);
+        merge(stations);
+    }
+}
+
+void aggregator::add_stream(read_function source, std::string const & name) {
+    auto const start = stats_clock::now();
+    auto peekable = std::make_shared<peekable_source>(std::move(source));
+    auto const c = detect_compression(peekable->peek(4));
+    if (options_.verbose_)
+        fmt::println(stderr, "Reading {} with {} compression.", name, compression_name(c));
+    add(aggregate_stream(decompressing_read_function(c, [peekable](char *buf, size_t len) {
+        return peekable->read(buf, len);
+    }), name, options_));
+    if (options_.stats_)
+        options_.stats_->aggregate_s_ = seconds_since(start);
+}
+
+void aggregator::add_buffer(std::string_view data) {
+    auto const start = stats_clock::now();
+    auto const end = data.rfind('\n') + 1; // 0 if there is no new-line at all
+    add(aggregate_file(memory_input(data), 0, end, options_));
+    if (end < data.size()) {
+        agg_map_type stations;
+        scan_lines(std::string(data.substr(end)) + '\n', 0, end, std::numeric_limits<size_t>::max(), stations, options_.scan_);
+        merge(stations);
+    }
+    if (options_.stats_)
+        options_.stats_->aggregate_s_ = seconds_since(start);
+}
+
+void aggregator::merge(aggregator const & other) {
+    for (auto const & shard : other.shards_)
+        merge(shard);
+}
+
+void aggregator::merge(agg_map_type const & stations) {
+    if (shards_.empty())
+        shards_.resize(1);
+    for (size_t shard = 0; shard < shards_.size(); ++shard)
+        shards_[shard].merge_shard(stations, shard, shards_.size());
+}
+
+auto aggregator::find(std::string_view station) const noexcept -> std::optional<station_statistics> {
+    if (shards_.empty())
+        return {};
+    auto const hash = agg_map_type::hash_key(station);
+    return shards_[agg_map_type::shard_of(hash, shards_.size())].find(hashed_key{station, hash});
+}
+
+size_t aggregator::station_count() const noexcept {
+    size_t cnt = 0;
+    for (auto const & shard : shards_)
+        cnt += shard.size();
+    return cnt;
+}
+
+uint64_t aggregator::measurement_count() const noexcept {
+    uint64_t cnt = 0;
+    for (auto const & shard : shards_)
+        for (auto const & e : shard.table())
+            cnt += e.value_.cnt_;
+    return cnt;
+}
+
+auto aggregator::results(sort_order order) const -> std::vector<result_entry> {
+    return sorted_results(shards_, order, options_.scan_.group_by_);
+}
+
+void aggregator::add(std::vector<agg_map_type> && shards) {
+    if (shards_.empty()) {
+        shards_ = std::move(shards);
+        return;
+    }
+    for (auto const & shard : shards)
+        merge(shard);
+}
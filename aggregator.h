@@ -0,0 +1,133 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mmapped_file.h"
+#include "result_output.h"
+#include "run_stats.h"
+#include "scan_input.h"
+#include "station_map.h"
+#include "station_table.h"
+#include "statistics.h"
+#include "stream_input.h"
+
+/**
+ * How regular uncompressed files are read.
+ */
+enum class io_backend {
+    mmap, // see mmapped_file and mapping_options
+    pread // see pread_file
+};
+
+inline auto parse_io_backend(std::string_view name) -> std::optional<io_backend> {
+    if (name == "mmap")
+        return io_backend::mmap;
+    if (name == "pread")
+        return io_backend::pread;
+    return {};
+}
+
+struct aggregator_options {
+    size_t threads_{std::max(1u, std::thread::hardware_concurrency())};
+    std::optional<size_t> range_size_; // size of the ranges claimed by the threads; derived from the file size if empty
+    std::optional<size_t> chunk_size_; // size of the chunks of a file mapped or read at once; the default of the backend if empty
+    scan_options scan_;                // value parser, number of value columns, distribution, time buckets and filter
+    io_backend io_{io_backend::mmap};
+    mapping_options mapping_;
+    bool direct_{false};               // pread only: bypass the page cache (O_DIRECT)
+    bool pin_threads_{false};          // pin the threads to CPUs spread over the NUMA nodes, see numa_topology.h
+    bool verbose_{false};              // progress messages on stderr
+    run_stats * stats_{nullptr};       // collect measurements of every add_*() if not null
+};
+
+/**
+ * Aggregates measurements of the form STATION;VALUE into statistics per
+ * station with multiple threads; the engine of the 1brc command line tool.
+ *
+ * Every add_*() call scans its input in parallel and combines the result
+ * with everything added before, so an aggregator can be fed file by file or
+ * buffer by buffer. Aggregators of different sources can be merged.
+ *
+ * The statistics are kept in shards with disjoint stations, one per thread
+ * of the first run; results() flattens and sorts them.
+ *
+ * Errors are thrown: format_error for malformed lines,
+ * std::runtime_error for input which cannot be opened or read,
+ * std::invalid_argument for options which cannot be used.
+ */
+class aggregator {
+public:
+    explicit aggregator(aggregator_options options = {});
+
+    aggregator(aggregator &&) noexcept = default;
+    aggregator &operator=(aggregator &&) noexcept = default;
+
+    /**
+     * add a file; a name of "-" is stdin, pipes and other non-regular files are
+     * streamed, zstd and gzip compressed files are decompressed
+     */
+    void add_file(std::string const & file_name);
+
+    /**
+     * add the lines from begin to end of a regular uncompressed file
+     * @param begin 0 or the offset behind a new-line
+     * @param end offset behind the last line to add; a last line without new-line ends at end
+     */
+    void add_file(std::string const & file_name, size_t begin, size_t end);
+
+    /**
+     * add a stream which is read from the calling thread until source returns 0;
+     * zstd and gzip compressed streams are decompressed
+     * @param name used in messages
+     */
+    void add_stream(read_function source, std::string const & name);
+
+    /**
+     * add the lines in data; the last line need not end with a new-line
+     */
+    void add_buffer(std::string_view data);
+
+    void merge(aggregator const & other);
+
+    /**
+     * combine stations which were aggregated elsewhere, e.g. loaded from a snapshot
+     */
+    void merge(agg_map_type const & stations);
+
+    /**
+     * @return the statistics of station or nothing if there were no values of it; valid until
+     * the aggregator is changed. Grouped by time buckets, station is a key of grouped_key
+     */
+    [[nodiscard]] auto find(std::string_view station) const noexcept -> std::optional<station_statistics>;
+
+    [[nodiscard]] size_t station_count() const noexcept;
+
+    [[nodiscard]] uint64_t measurement_count() const noexcept;
+
+    /**
+     * @return all stations in the given order; valid until the aggregator is changed
+     */
+    [[nodiscard]] auto results(sort_order order = sort_order::bytes) const -> std::vector<result_entry>;
+
+    [[nodiscard]] auto shards() const noexcept -> std::vector<agg_map_type> const & { return shards_; }
+
+    [[nodiscard]] auto options() const noexcept -> aggregator_options const & { return options_; }
+
+    void clear() noexcept { shards_.clear(); }
+
+private:
+    void add(std::vector<agg_map_type> && shards);
+
+    aggregator_options options_;
+    std::vector<agg_map_type> shards_;
+};
+
+#endif //AGGREGATOR_H
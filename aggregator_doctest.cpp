@@ -0,0 +1,318 @@
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <zstd.h>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "aggregator.h"
+#include <doctest/doctest.h>
+
+namespace {
+
+std::string temp_path(char const * name) {
+    return std::string(P_tmpdir) + "/" + name + "." + std::to_string(getpid());
+}
+
+/**
+ * compress data as one zstd frame per piece of at most piece bytes, cut anywhere within the lines
+ * @param content_size whether the frames declare the size of their content
+ */
+std::string zstd_compress_frames(std::string_view data, size_t piece, bool content_size = true) {
+    std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> cctx{ZSTD_createCCtx(), ZSTD_freeCCtx};
+    ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, 1);
+    ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_contentSizeFlag, content_size ? 1 : 0);
+    std::string out;
+    for (size_t pos = 0; pos < data.size(); pos += piece) {
+        auto const part = data.substr(pos, piece);
+        std::string frame(ZSTD_compressBound(part.size()), '\0');
+        size_t len;
+        if (content_size) {
+            len = ZSTD_compress2(cctx.get(), frame.data(), frame.size(), part.data(), part.size());
+        } else {
+            // streamed without a pledged size, the frame header has no content size
+            ZSTD_inBuffer in{part.data(), part.size(), 0};
+            ZSTD_outBuffer frame_out{frame.data(), frame.size(), 0};
+            len = ZSTD_compressStream2(cctx.get(), &frame_out, &in, ZSTD_e_end);
+            if (len == 0)
+                len = frame_out.pos;
+        }
+        CHECK_FALSE(ZSTD_isError(len));
+        out.append(frame.data(), len);
+    }
+    return out;
+}
+
+std::string format_error_message(aggregator & agg, auto add) {
+    try {
+        add(agg);
+    } catch (format_error const & e) {
+        return e.what();
+    }
+    return {};
+}
+
+} // namespace
+
+TEST_CASE("Check aggregator") {
+    using namespace std::string_view_literals;
+    aggregator_options options;
+    options.threads_ = 4;
+    options.range_size_ = 1;
+    aggregator agg(options);
+
+    std::string input;
+    for (int i = 0; i < 10000; ++i)
+        input += i % 2 ? "Hamburg;12.0\n" : "Bulawayo;-8.9\n";
+    agg.add_buffer(input);
+    CHECK(agg.station_count() == 2);
+    CHECK(agg.measurement_count() == 10000);
+    REQUIRE(agg.find("Hamburg"sv).has_value());
+    CHECK(agg.find("Hamburg"sv)->cnt_ == 5000);
+    CHECK(agg.find("Hamburg"sv)->avg_tenths() == 120);
+    CHECK_FALSE(agg.find("Kairo"sv).has_value());
+
+    SUBCASE("last line without new-line") {
+        agg.add_buffer("Kairo;17.4\nHamburg;-3.5"sv);
+        CHECK(agg.measurement_count() == 10002);
+        REQUIRE(agg.find("Kairo"sv).has_value());
+        CHECK(agg.find("Hamburg"sv)->min_tenths() == -35);
+    }
+    SUBCASE("merge") {
+        aggregator other(aggregator_options{.threads_ = 1});
+        other.add_buffer("Kairo;17.4\nBulawayo;40.1\n"sv);
+        agg.merge(other);
+        auto const results = agg.results(sort_order::bytes);
+        REQUIRE(results.size() == 3);
+        CHECK(results[0].name_ == "Bulawayo"sv);
+        CHECK(results[0].stats_.max_tenths() == 401);
+        CHECK(results[0].stats_.cnt_ == 5001);
+        CHECK(results[2].name_ == "Kairo"sv);
+    }
+    SUBCASE("broken input") {
+        CHECK_THROWS_AS(agg.add_buffer("Kairo;17.4\nKairo17.4\n"sv), format_error);
+        CHECK_THROWS_AS(agg.add_buffer("Kairo;17.4;1\n"sv), format_error);
+    }
+    SUBCASE("clear") {
+        agg.clear();
+        CHECK(agg.station_count() == 0);
+        CHECK_FALSE(agg.find("Hamburg"sv).has_value());
+    }
+}
+
+TEST_CASE("Check aggregator parts of a file") {
+    using namespace std::string_view_literals;
+    auto const path = temp_path("aggregator_doctest.txt");
+    std::ofstream(path, std::ios::binary) << "Abha;1.0\nKairo;17.4\nAbha;3.0";
+    aggregator whole(aggregator_options{.threads_ = 2});
+    whole.add_file(path);
+    CHECK(whole.measurement_count() == 3);
+
+    // e.g. the complete lines for a snapshot and then the last line without new-line
+    aggregator parts(aggregator_options{.threads_ = 2});
+    parts.add_file(path, 0, 20);
+    CHECK(parts.measurement_count() == 2);
+    parts.add_file(path, 20, 28);
+    CHECK(parts.measurement_count() == 3);
+    CHECK(parts.find("Abha"sv)->max_tenths() == 30);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Check aggregator value parsers") {
+    using namespace std::string_view_literals;
+    auto const input = "Abha;7\nAbha;-12.25\n"sv;
+    aggregator tenths(aggregator_options{.scan_ = {.parser_ = value_parser::tenths}});
+    CHECK_THROWS_AS(tenths.add_buffer(input), format_error);
+    aggregator decimal(aggregator_options{.scan_ = {.parser_ = value_parser::decimal}});
+    decimal.add_buffer(input);
+    REQUIRE(decimal.find("Abha"sv).has_value());
+    CHECK(decimal.find("Abha"sv)->max_tenths() == 70);
+    CHECK(decimal.find("Abha"sv)->cnt_ == 2);
+}
+
+TEST_CASE("Check aggregator value columns") {
+    using namespace std::string_view_literals;
+    aggregator agg(aggregator_options{.threads_ = 2, .range_size_ = 8, .scan_ = {.columns_ = 3}});
+    agg.add_buffer("Abha;1.0;50.0;10.0\nKairo;17.4;20.0;-1.0\nAbha;-3.0;70.0;12.0\n"sv);
+    auto const abha = agg.find("Abha"sv);
+    REQUIRE(abha.has_value());
+    REQUIRE(abha->columns() == 3);
+    CHECK(abha->cnt_ == 2);
+    CHECK(abha->column(0).min_tenths() == -30);
+    CHECK(abha->column(1).avg_tenths() == 600);
+    CHECK(abha->column(2).max_tenths() == 120);
+    CHECK(abha->column(2).cnt_ == 2);
+    CHECK_THROWS_AS(agg.add_buffer("Abha;1.0;50.0\n"sv), format_error);
+    CHECK_THROWS_AS(agg.add_buffer("Abha;1.0;50.0;1.0;2.0\n"sv), format_error);
+    CHECK_THROWS_AS(agg.add_buffer("Abha;1.0;50.0;\n"sv), format_error);
+    CHECK_THROWS_AS(aggregator(aggregator_options{.scan_ = {.columns_ = 0}}), std::invalid_argument);
+}
+
+TEST_CASE("Check aggregator value range") {
+    using namespace std::string_view_literals;
+    aggregator pressure(aggregator_options{.threads_ = 2, .range_size_ = 8, .scan_ = {.parser_ = value_parser::decimal, .columns_ = 2}});
+    pressure.add_buffer("Abha;12.3;101325\nAbha;-4.5;99000.5\n"sv);
+    auto const abha = pressure.find("Abha"sv);
+    REQUIRE(abha.has_value());
+    CHECK(abha->column(1).min_tenths() == 990005);
+    CHECK(abha->column(1).avg_tenths() == 1001628);
+    CHECK(abha->column(1).max_tenths() == 1013250);
+
+    aggregator single(aggregator_options{.threads_ = 1, .scan_ = {.parser_ = value_parser::decimal}});
+    single.add_buffer("Abha;3276.7\nAbha;-3276.8\n"sv);
+    CHECK(single.find("Abha"sv)->max_tenths() == 32767);
+    CHECK(single.find("Abha"sv)->min_tenths() == -32768);
+#ifdef USE_FIXED_POINT_STATISTICS
+    // the first column is kept in the station table as 16 bit tenths, the others as 32 bit tenths
+    CHECK_THROWS_WITH_AS(pressure.add_buffer("Abha;1.0;2.0\nAbha;3276.8;2.0\n"sv),
+                         "Broken format in input file: value 3276.8 out of range at offset 24", format_error);
+    CHECK_THROWS_AS(pressure.add_buffer("Abha;1.0;300000000\n"sv), format_error);
+    CHECK_THROWS_WITH_AS(single.add_buffer("Abha;1.0\nAbha;101325\n"sv),
+                         "Broken format in input file: value 101325 out of range at offset 20", format_error);
+#endif
+}
+
+TEST_CASE("Check aggregator distribution") {
+    using namespace std::string_view_literals;
+    aggregator agg(aggregator_options{.threads_ = 3, .range_size_ = 16, .scan_ = {.distribution_ = true}});
+    std::string input;
+    for (int i = 1; i <= 100; ++i)
+        input += "Abha;" + std::to_string(i / 10) + "." + std::to_string(i % 10) + "\n";
+    agg.add_buffer(input);
+    agg.add_buffer("Abha;0.1\n"sv);
+    auto const abha = agg.find("Abha"sv);
+    REQUIRE(abha.has_value());
+    REQUIRE(abha->histogram() != nullptr);
+    CHECK(abha->histogram()->count(1) == 2);
+    CHECK(abha->percentile_tenths(50) == 50);
+    CHECK(abha->percentile_tenths(99) == 99);
+}
+
+TEST_CASE("Check aggregator grouped by time buckets") {
+    using namespace std::string_view_literals;
+    aggregator agg(aggregator_options{.threads_ = 2, .range_size_ = 16, .scan_ = {.group_by_ = time_bucket::hour}});
+    agg.add_buffer("2024-05-01T13:45:00Z;Abha;1.0\n"
+                   "1714571999;Abha;3.0\n"
+                   "2024-05-01T16:00:00+02:00;Abha;5.0\n"
+                   "2024-05-01T14:00:00Z;Abha;7.0\n"
+                   "2024-05-01T13:00:00Z;Kairo;2.0\n"sv);
+    CHECK(agg.station_count() == 3);
+    CHECK(agg.measurement_count() == 5);
+    auto const results = agg.results();
+    REQUIRE(results.size() == 3);
+    CHECK(results[0].name_ == "Abha"sv);
+    CHECK(results[0].bucket_start_ == 1714568400);
+    CHECK(results[0].stats_.cnt_ == 2);
+    CHECK(results[0].stats_.max_tenths() == 30);
+    CHECK(results[1].name_ == "Abha"sv);
+    CHECK(results[1].bucket_start_ == 1714572000);
+    CHECK(results[1].stats_.cnt_ == 2);
+    CHECK(results[1].stats_.min_tenths() == 50);
+    CHECK(results[2].name_ == "Kairo"sv);
+    CHECK(results[2].bucket_start_ == 1714568400);
+    CHECK_THROWS_AS(agg.add_buffer("Abha;1.0\n"sv), format_error);
+    CHECK_THROWS_AS(agg.add_buffer("yesterday;Abha;1.0\n"sv), format_error);
+    CHECK_THROWS_AS(agg.add_buffer("1714571999;Abha;1.0;2.0\n"sv), format_error);
+
+    aggregator columns(aggregator_options{.threads_ = 1, .scan_ = {.columns_ = 2, .group_by_ = time_bucket::day}});
+    columns.add_buffer("2024-05-01 13:45:00;Abha;1.0;50.0\n2024-05-01 23:59:59;Abha;3.0;70.0\n"sv);
+    auto const day = columns.results();
+    REQUIRE(day.size() == 1);
+    CHECK(day[0].bucket_start_ == 1714521600);
+    CHECK(day[0].stats_.column(1).avg_tenths() == 600);
+}
+
+TEST_CASE("Check aggregator filter") {
+    using namespace std::string_view_literals;
+    auto stations = std::make_shared<line_filter>();
+    stations->allow_stations({"Abha", "Kairo"});
+    aggregator agg(aggregator_options{.threads_ = 2, .range_size_ = 8, .scan_ = {.filter_ = stations}});
+    agg.add_buffer("Abha;1.0\nHamburg;broken\nKairo;17.4\nAbha;-3.0\nHamburg;12.0\n"sv);
+    CHECK(agg.station_count() == 2);
+    CHECK(agg.measurement_count() == 3);
+    CHECK_FALSE(agg.find("Hamburg"sv).has_value());
+    CHECK_THROWS_AS(agg.add_buffer("Abha;broken\n"sv), format_error);
+
+    auto warm = std::make_shared<line_filter>();
+    warm->allow_stations({"Abha", "Kairo"});
+    warm->add_predicate(predicate{1, comparison::greater, 30});
+    aggregator columns(aggregator_options{.threads_ = 1, .scan_ = {.columns_ = 2, .filter_ = warm}});
+    columns.add_buffer("Abha;1.0;50.0\nKairo;17.4;20.0\nAbha;-3.0;30.1\nHamburg;1.0;99.0\n"sv);
+    REQUIRE(columns.find("Abha"sv).has_value());
+    CHECK(columns.find("Abha"sv)->cnt_ == 2);
+    CHECK_FALSE(columns.find("Kairo"sv).has_value());
+    CHECK(columns.station_count() == 1);
+
+    aggregator grouped(aggregator_options{.threads_ = 1, .scan_ = {.group_by_ = time_bucket::day, .filter_ = stations}});
+    grouped.add_buffer("1714571100;Abha;1.0\n1714571100;Hamburg;2.0\n"sv);
+    CHECK(grouped.measurement_count() == 1);
+
+    CHECK_THROWS_AS(aggregator(aggregator_options{.scan_ = {.filter_ = warm}}), std::invalid_argument);
+}
+
+TEST_CASE("Check aggregator zstd file larger than a chunk") {
+    std::string input;
+    uint32_t random = 1;
+    for (int i = 0; i < 50'000; ++i) {
+        random = random * 1103515245 + 12345;
+        input += "station " + std::to_string(random % 397) + ";" + std::to_string(static_cast<int>(random >> 16) % 999 - 499) + "."
+                 + std::to_string((random >> 8) % 10) + "\n";
+    }
+    input.pop_back(); // the last line need not end with a new-line
+    auto const path = temp_path("aggregator_doctest.zst");
+    auto const compressed = zstd_compress_frames(input, 100'001);
+    std::ofstream(path, std::ios::binary) << compressed;
+
+    aggregator expected(aggregator_options{.threads_ = 1});
+    expected.add_buffer(input);
+    for (size_t threads : {1, 4}) {
+        CAPTURE(threads);
+        // the smallest chunk is two pages, so the file spans many chunks
+        aggregator agg(aggregator_options{.threads_ = threads, .chunk_size_ = 4096});
+        REQUIRE(compressed.size() > 4 * 4096);
+        agg.add_file(path);
+        CHECK(agg.measurement_count() == 50'000);
+        CHECK(agg.station_count() == expected.station_count());
+        auto const results = agg.results();
+        auto const expected_results = expected.results();
+        REQUIRE(results.size() == expected_results.size());
+        for (size_t n = 0; n < results.size(); ++n) {
+            CHECK(results[n].name_ == expected_results[n].name_);
+            CHECK(results[n].stats_.cnt_ == expected_results[n].stats_.cnt_);
+            // float sums depend on the order of the values
+            CHECK(static_cast<double>(results[n].stats_.sum_)
+                  == doctest::Approx(static_cast<double>(expected_results[n].stats_.sum_)).epsilon(1e-4).scale(1000));
+            CHECK(results[n].stats_.min_ == expected_results[n].stats_.min_);
+            CHECK(results[n].stats_.max_ == expected_results[n].stats_.max_);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Check aggregator format errors in zstd frames") {
+    using namespace std::string_view_literals;
+    auto const path = temp_path("aggregator_doctest_errors.zst");
+    aggregator agg(aggregator_options{.threads_ = 4});
+    for (size_t broken_line : {1000, 1050}) {
+        CAPTURE(broken_line);
+        std::string input;
+        for (size_t i = 0; i < 2000; ++i)
+            input += i == broken_line ? "Abha1.0\n"sv : "Abha;1.0\n"sv;
+        auto const expected = format_error_message(agg, [&input](auto & a) { a.add_buffer(input); });
+        REQUIRE_FALSE(expected.empty());
+
+        // the frames of 1000 bytes cut the lines; line 1000 starts at a frame boundary and is put together
+        // from the frames, line 1050 is within the 10th frame
+        std::ofstream(path, std::ios::binary) << zstd_compress_frames(input, 1000);
+        CHECK(format_error_message(agg, [&path](auto & a) { a.add_file(path); }) == expected);
+
+        std::ofstream(path, std::ios::binary) << zstd_compress_frames(input, 1000, false);
+        auto const message = format_error_message(agg, [&path](auto & a) { a.add_file(path); });
+        if (broken_line == 1050)
+            CHECK(message == "Broken format in input file: not 2 fields at offset 457 of zstd frame 9"sv);
+        else
+            CHECK(message == expected);
+    }
+    std::remove(path.c_str());
+}
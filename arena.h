@@ -0,0 +1,79 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Bump allocator: memory is handed out from large blocks and only released
+ * as a whole when the arena is destroyed.
+ *
+ * An arena is not thread safe; every worker thread fills its own one. Memory
+ * handed out never moves, so other threads may read it once the owner is
+ * done writing (e.g. when merging the tables of all threads).
+ */
+class arena {
+public:
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+    arena() = default;
+    arena(arena const &) = delete;
+    arena &operator=(arena const &) = delete;
+
+    arena(arena && other) noexcept
+        : blocks_{std::move(other.blocks_)}, pos_{std::exchange(other.pos_, nullptr)},
+          left_{std::exchange(other.left_, 0)}, used_{std::exchange(other.used_, 0)} {
+    }
+
+    arena &operator=(arena && other) noexcept {
+        blocks_ = std::move(other.blocks_);
+        pos_ = std::exchange(other.pos_, nullptr);
+        left_ = std::exchange(other.left_, 0);
+        used_ = std::exchange(other.used_, 0);
+        return *this;
+    }
+
+    /**
+     * @return uninitialized memory of size bytes aligned to alignment (a power of two)
+     */
+    void * allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        auto padding = (alignment - reinterpret_cast<uintptr_t>(pos_) % alignment) % alignment;
+        if (size + padding > left_) {
+            size_t const block = std::max(BLOCK_SIZE, size + alignment);
+            pos_ = blocks_.emplace_back(std::make_unique_for_overwrite<char[]>(block)).get();
+            left_ = block;
+            padding = (alignment - reinterpret_cast<uintptr_t>(pos_) % alignment) % alignment;
+        }
+        char * const result = pos_ + padding;
+        pos_ += padding + size;
+        left_ -= padding + size;
+        used_ += size;
+        return result;
+    }
+
+    /**
+     * @return a copy of s stored in the arena
+     */
+    std::string_view store(std::string_view s) {
+        auto * p = static_cast<char *>(allocate(s.size(), 1));
+        std::memcpy(p, s.data(), s.size());
+        return {p, s.size()};
+    }
+
+    /** @return the bytes handed out */
+    [[nodiscard]] size_t bytes_used() const noexcept { return used_; }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char * pos_{nullptr};
+    size_t left_{0};
+    size_t used_{0};
+};
+
+#endif //ARENA_H
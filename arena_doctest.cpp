@@ -0,0 +1,32 @@
+#include <cstdint>
+#include <string>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "arena.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check arena") {
+    using namespace std::string_view_literals;
+    arena a;
+    CHECK(a.bytes_used() == 0);
+    auto const hello = a.store("hello"sv);
+    CHECK(hello == "hello"sv);
+    auto * p = a.allocate(sizeof(uint64_t), alignof(uint64_t));
+    CHECK(reinterpret_cast<uintptr_t>(p) % alignof(uint64_t) == 0);
+    CHECK(a.bytes_used() == 5 + sizeof(uint64_t));
+
+    SUBCASE("large allocations get a block of their own") {
+        auto const big = std::string(arena::BLOCK_SIZE + 1, 'b');
+        CHECK(a.store(big) == big);
+        CHECK(a.store("after"sv) == "after"sv);
+    }
+    SUBCASE("memory does not move") {
+        std::vector<std::string_view> stored;
+        for (int i = 0; i < 100000; ++i)
+            stored.push_back(a.store(std::to_string(i)));
+        for (int i = 0; i < 100000; i += 997)
+            CHECK(stored[static_cast<size_t>(i)] == std::to_string(i));
+        arena moved(std::move(a));
+        CHECK(stored[42] == "42"sv);
+        CHECK(hello == "hello"sv);
+    }
+}
@@ -0,0 +1,325 @@
+// Micro and macro benchmarks; run e.g.
+//   build/bench --benchmark_out=bench.json --benchmark_out_format=json
+// and compare two result files with compare.py of google-benchmark.
+// BM_scan_input additionally runs with the size given by --rows=N and
+// --stations=N, e.g. `build/bench --benchmark_filter=scan --rows=50000000`.
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <fmt/core.h>
+
+#include "line_filter.h"
+#include "memory_input.h"
+#include "scan_input.h"
+#include "simple_parse_float.h"
+#include "station_table.h"
+#include "time_bucket.h"
+
+namespace {
+
+/**
+ * deterministic station names of 3 to 24 characters, some of them with
+ * multi byte UTF-8 characters like the names of the challenge
+ */
+auto make_station_names(size_t count, uint64_t seed = 4711) -> std::vector<std::string> {
+    static constexpr std::string_view letters = "abcdefghijklmnopqrstuvwxyz";
+    static constexpr std::string_view umlauts[] = {"ä", "ö", "ü", "é", "ñ"};
+    std::mt19937_64 rnd{seed};
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string name = fmt::format("{}", i);
+        size_t const len = 3 + rnd() % 22;
+        while (name.size() < len) {
+            if (rnd() % 16 == 0)
+                name += umlauts[rnd() % std::size(umlauts)];
+            else
+                name += letters[rnd() % letters.size()];
+        }
+        names.push_back(std::move(name));
+    }
+    return names;
+}
+
+auto make_values(size_t count, uint64_t seed = 4711) -> std::vector<std::string> {
+    std::mt19937_64 rnd{seed};
+    std::vector<std::string> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto const tenths = static_cast<int>(rnd() % 1999) - 999;
+        values.push_back(fmt::format("{}{}.{}", tenths < 0 ? "-" : "", std::abs(tenths) / 10, std::abs(tenths) % 10));
+    }
+    return values;
+}
+
+/**
+ * rows of input in the format of measurements.txt
+ */
+auto make_input(size_t rows, size_t stations) -> std::string {
+    auto const names = make_station_names(stations);
+    std::mt19937_64 rnd{42};
+    std::string input;
+    input.reserve(rows * 16);
+    for (size_t i = 0; i < rows; ++i) {
+        auto const tenths = static_cast<int>(rnd() % 1999) - 999;
+        input += names[rnd() % names.size()];
+        input += fmt::format(";{}{}.{}\n", tenths < 0 ? "-" : "", std::abs(tenths) / 10, std::abs(tenths) % 10);
+    }
+    return input;
+}
+
+/**
+ * like make_input, with lines TIMESTAMP;STATION;VALUE over a week, half of the
+ * timestamps ISO-8601 and half seconds since the epoch
+ */
+auto make_grouped_input(size_t rows, size_t stations) -> std::string {
+    auto const names = make_station_names(stations);
+    std::mt19937_64 rnd{42};
+    std::string input;
+    input.reserve(rows * 40);
+    for (size_t i = 0; i < rows; ++i) {
+        auto const seconds = 1714521600 + static_cast<int64_t>(rnd() % (7 * 86400));
+        if (i % 2 == 0) {
+            auto const date = civil_from_days(seconds / 86400);
+            auto const time = seconds % 86400;
+            input += fmt::format("{:04}-{:02}-{:02}T{:02}:{:02}:{:02}Z;", date.year_, date.month_, date.day_,
+                                 time / 3600, time / 60 % 60, time % 60);
+        } else {
+            input += fmt::format("{};", seconds);
+        }
+        auto const tenths = static_cast<int>(rnd() % 1999) - 999;
+        input += names[rnd() % names.size()];
+        input += fmt::format(";{}{}.{}\n", tenths < 0 ? "-" : "", std::abs(tenths) / 10, std::abs(tenths) % 10);
+    }
+    return input;
+}
+
+static constexpr size_t VALUE_COUNT = 4096;
+
+/**
+ * parse VALUE_COUNT values which lie one per line in a single buffer like
+ * in the input, so the parsers may read behind a value as scan_input allows
+ * @param parse called with a value and the number of readable bytes from its start
+ */
+template<typename Parser>
+void parse_values(benchmark::State &state, Parser parse) {
+    auto const values = make_values(VALUE_COUNT);
+    std::string buffer;
+    for (auto const &v : values) {
+        buffer += v;
+        buffer += '\n';
+    }
+    std::vector<std::string_view> views;
+    views.reserve(values.size());
+    for (size_t pos = 0; pos < buffer.size();) {
+        auto const nl = buffer.find('\n', pos);
+        views.emplace_back(buffer.data() + pos, nl - pos);
+        pos = nl + 1;
+    }
+    char const *const end = buffer.data() + buffer.size();
+    for (auto _ : state) {
+        for (auto const &v : views)
+            benchmark::DoNotOptimize(parse(v, static_cast<size_t>(end - v.data())));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * views.size()));
+}
+
+void BM_simple_parse_float(benchmark::State &state) {
+    parse_values(state, [](std::string_view v, size_t) { return simple_parse_float(v); });
+}
+BENCHMARK(BM_simple_parse_float);
+
+void BM_simple_parse_float2(benchmark::State &state) {
+    parse_values(state, [](std::string_view v, size_t) { return simple_parse_float2(v); });
+}
+BENCHMARK(BM_simple_parse_float2);
+
+void BM_super_simple_parse_float(benchmark::State &state) {
+    parse_values(state, [](std::string_view v, size_t) { return super_simple_parse_float(v); });
+}
+BENCHMARK(BM_super_simple_parse_float);
+
+void BM_swar_parse_tenths(benchmark::State &state) {
+    parse_values(state, [](std::string_view v, size_t readable) { return swar_parse_tenths(v, readable); });
+}
+BENCHMARK(BM_swar_parse_tenths);
+
+template<typename Hasher>
+void BM_hasher(benchmark::State &state) {
+    auto const names = make_station_names(VALUE_COUNT);
+    Hasher hasher;
+    size_t bytes = 0;
+    for (auto const &name : names)
+        bytes += name.size();
+    for (auto _ : state) {
+        for (auto const &name : names)
+            benchmark::DoNotOptimize(hasher(name));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * names.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_hasher<simple_hasher>);
+BENCHMARK(BM_hasher<word_hasher>);
+
+/**
+ * lookups of existing keys in random order, i.e. the common case of the scan
+ * @param state range(0) is the number of stations
+ */
+void BM_station_table_update(benchmark::State &state) {
+    auto const names = make_station_names(static_cast<size_t>(state.range(0)));
+    std::vector<std::string_view> keys;
+    std::mt19937_64 rnd{42};
+    for (size_t i = 0; i < VALUE_COUNT; ++i)
+        keys.push_back(names[rnd() % names.size()]);
+    station_table<statistics> table;
+    for (auto const &name : names)
+        table.try_emplace(name, statistics::from_tenths(0));
+    auto const value = statistics::from_tenths(123);
+    for (auto _ : state) {
+        for (auto key : keys) {
+            auto [found, inserted] = table.try_emplace(key, value);
+            if (!inserted)
+                found->add_value(value);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+BENCHMARK(BM_station_table_update)->Arg(413)->Arg(10'000)->Arg(100'000);
+
+/**
+ * filling an empty table including its growth
+ * @param state range(0) is the number of stations
+ */
+void BM_station_table_insert(benchmark::State &state) {
+    auto const names = make_station_names(static_cast<size_t>(state.range(0)));
+    auto const value = statistics::from_tenths(123);
+    for (auto _ : state) {
+        station_table<statistics> table;
+        for (auto const &name : names)
+            table.try_emplace(name, value);
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * names.size()));
+}
+BENCHMARK(BM_station_table_insert)->Arg(413)->Arg(10'000)->Arg(100'000);
+
+/**
+ * scan_input over generated in-memory data as one range
+ * @param state range(0) is the number of rows, range(1) the number of stations
+ */
+void BM_scan_input(benchmark::State &state) {
+    auto const input = make_input(static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    memory_input reader(input);
+    for (auto _ : state) {
+        agg_map_type table;
+        scan_input(reader, 0, input.size(), table, 0, false);
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_scan_input)
+    ->ArgNames({"rows", "stations"})
+    ->ArgsProduct({{1 << 16, 1 << 20}, {413, 10'000}})
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * like BM_scan_input, but keeping the distributions for percentiles
+ */
+void BM_scan_input_distribution(benchmark::State &state) {
+    auto const input = make_input(static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    memory_input reader(input);
+    for (auto _ : state) {
+        agg_map_type table;
+        scan_input(reader, 0, input.size(), table, 0, false, scan_options{.distribution_ = true});
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_scan_input_distribution)
+    ->ArgNames({"rows", "stations"})
+    ->ArgsProduct({{1 << 20}, {413, 10'000}})
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * scan_input with --group-by hour over the input of make_grouped_input
+ */
+void BM_scan_input_grouped(benchmark::State &state) {
+    auto const input = make_grouped_input(static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    memory_input reader(input);
+    for (auto _ : state) {
+        agg_map_type table;
+        scan_input(reader, 0, input.size(), table, 0, false, scan_options{.group_by_ = time_bucket::hour});
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_scan_input_grouped)
+    ->ArgNames({"rows", "stations"})
+    ->ArgsProduct({{1 << 20}, {413, 10'000}})
+    ->Unit(benchmark::kMillisecond);
+
+/**
+ * like BM_scan_input, keeping only every 16th station (allowlist) or only
+ * the values above 50.0 (predicate)
+ * @param state range(2) is 0 for the allowlist, 1 for the predicate
+ */
+void BM_scan_input_filtered(benchmark::State &state) {
+    auto const stations = static_cast<size_t>(state.range(1));
+    auto const input = make_input(static_cast<size_t>(state.range(0)), stations);
+    auto filter = std::make_shared<line_filter>();
+    if (state.range(2) == 0) {
+        auto names = make_station_names(stations);
+        std::vector<std::string> allowed;
+        for (size_t i = 0; i < names.size(); i += 16)
+            allowed.push_back(names[i]);
+        filter->allow_stations(allowed);
+    } else {
+        filter->add_predicate(predicate{0, comparison::greater, 50.});
+    }
+    memory_input reader(input);
+    for (auto _ : state) {
+        agg_map_type table;
+        scan_input(reader, 0, input.size(), table, 0, false, scan_options{.filter_ = filter});
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+}
+BENCHMARK(BM_scan_input_filtered)
+    ->ArgNames({"rows", "stations", "predicate"})
+    ->ArgsProduct({{1 << 20}, {413, 10'000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    std::optional<int64_t> rows, stations;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        if (arg.starts_with("--rows="))
+            rows = std::stoll(std::string(arg.substr(7)));
+        else if (arg.starts_with("--stations="))
+            stations = std::stoll(std::string(arg.substr(11)));
+        else {
+            fmt::println(stderr, "Unknown argument {}", arg);
+            return 1;
+        }
+    }
+    if (rows || stations)
+        benchmark::RegisterBenchmark("BM_scan_input", BM_scan_input)
+            ->ArgNames({"rows", "stations"})
+            ->Args({rows.value_or(1 << 20), stations.value_or(413)})
+            ->Unit(benchmark::kMillisecond);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
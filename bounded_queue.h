@@ -0,0 +1,97 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+/**
+ * A FIFO queue for handing work from producer to consumer threads. push()
+ * blocks while the queue holds capacity elements, so a fast producer cannot
+ * run away from the consumers. After close() no more elements are accepted
+ * and pop() returns an empty optional once the queue is drained.
+ */
+template<typename T>
+class bounded_queue {
+public:
+    explicit bounded_queue(size_t capacity) : capacity_{capacity} {
+    }
+
+    /**
+     * @return false if the queue was closed and value was not added
+     */
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_full_.wait(lock, [this] { return closed_ || queue_.size() < capacity_; });
+        if (closed_)
+            return false;
+        queue_.push_back(std::move(value));
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @return false if the queue is full or closed and value was not added
+     */
+    bool try_push(T value) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (closed_ || queue_.size() >= capacity_)
+                return false;
+            queue_.push_back(std::move(value));
+        }
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * wait for the next element
+     * @return the element or an empty optional if the queue is closed and empty
+     */
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+        return take(lock);
+    }
+
+    /**
+     * @return the next element or an empty optional if there is none right now
+     */
+    std::optional<T> try_pop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        return take(lock);
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    std::optional<T> take(std::unique_lock<std::mutex> & lock) {
+        if (queue_.empty())
+            return {};
+        std::optional<T> value{std::move(queue_.front())};
+        queue_.pop_front();
+        lock.unlock();
+        not_full_.notify_one();
+        return value;
+    }
+
+    size_t const capacity_;
+    std::mutex mtx_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::deque<T> queue_;
+    bool closed_{false};
+};
+
+#endif //BOUNDED_QUEUE_H
@@ -0,0 +1,250 @@
+#ifndef COMPRESSED_INPUT_H
+#define COMPRESSED_INPUT_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "stream_input.h"
+
+/**
+ * Decompression of zstd and gzip input.
+ *
+ * Both formats are decoded by read_functions, so a compressed stream can be
+ * fed into stream_input like an uncompressed one. A zstd file which consists
+ * of several independent frames (e.g. written by pzstd or in the seekable
+ * format) can additionally be split with zstd_frames() and the frames be
+ * decompressed in parallel.
+ */
+enum class compression { none, gzip, zstd };
+
+/**
+ * @param magic the first (up to 4) bytes of the input
+ */
+inline auto detect_compression(std::string_view magic) noexcept -> compression {
+    using namespace std::string_view_literals;
+    if (magic.starts_with("\x28\xb5\x2f\xfd"sv))
+        return compression::zstd;
+    if (magic.starts_with("\x1f\x8b"sv))
+        return compression::gzip;
+    return compression::none;
+}
+
+/**
+ * @return the compression of a regular file judging by its first bytes
+ */
+inline auto file_compression(std::string const &file_name) -> compression {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return compression::none;
+    char magic[4];
+    auto const n = pread(fd, magic, sizeof(magic), 0);
+    close(fd);
+    return n > 0 ? detect_compression({magic, static_cast<size_t>(n)}) : compression::none;
+}
+
+inline auto compression_name(compression c) noexcept -> char const * {
+    switch (c) {
+        case compression::gzip: return "gzip";
+        case compression::zstd: return "zstd";
+        default: return "no";
+    }
+}
+
+/**
+ * Allows to look at the first bytes of a stream before it is read.
+ */
+class peekable_source {
+public:
+    explicit peekable_source(read_function source) : source_{std::move(source)} {
+    }
+
+    /**
+     * @return the first (up to) len bytes of the stream; they are returned by read() again
+     */
+    std::string_view peek(size_t len) {
+        while (prefix_.size() < len) {
+            auto const old_size = prefix_.size();
+            prefix_.resize(len);
+            auto const n = source_(prefix_.data() + old_size, len - old_size);
+            prefix_.resize(old_size + n);
+            if (n == 0)
+                break;
+        }
+        return {prefix_.data(), std::min(len, prefix_.size())};
+    }
+
+    size_t read(char *buf, size_t len) {
+        if (prefix_pos_ < prefix_.size()) {
+            auto const n = std::min(len, prefix_.size() - prefix_pos_);
+            std::memcpy(buf, prefix_.data() + prefix_pos_, n);
+            prefix_pos_ += n;
+            return n;
+        }
+        return source_(buf, len);
+    }
+
+private:
+    read_function source_;
+    std::vector<char> prefix_;
+    size_t prefix_pos_{0};
+};
+
+/**
+ * Decompresses zstd data (any number of frames) either from a stream or from memory.
+ */
+class zstd_decoder {
+public:
+    explicit zstd_decoder(read_function source)
+        : dctx_{ZSTD_createDCtx()}, source_{std::move(source)}, input_buffer_(ZSTD_DStreamInSize()) {
+        check_context();
+    }
+
+    explicit zstd_decoder(std::string_view data)
+        : dctx_{ZSTD_createDCtx()}, input_{data.data(), data.size(), 0} {
+        check_context();
+    }
+
+    size_t read(char *buf, size_t len) {
+        ZSTD_outBuffer output{buf, len, 0};
+        while (output.pos == 0) {
+            if (input_.pos == input_.size && !refill()) {
+                if (!frame_complete_)
+                    throw std::runtime_error("Truncated zstd input");
+                break;
+            }
+            auto const ret = ZSTD_decompressStream(dctx_.get(), &output, &input_);
+            if (ZSTD_isError(ret))
+                throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(ret));
+            frame_complete_ = ret == 0;
+        }
+        return output.pos;
+    }
+
+private:
+    struct dctx_deleter {
+        void operator()(ZSTD_DCtx *dctx) const noexcept { ZSTD_freeDCtx(dctx); }
+    };
+
+    void check_context() const {
+        if (!dctx_)
+            throw std::bad_alloc();
+    }
+
+    bool refill() {
+        if (!source_)
+            return false;
+        input_ = {input_buffer_.data(), source_(input_buffer_.data(), input_buffer_.size()), 0};
+        return input_.size > 0;
+    }
+
+    std::unique_ptr<ZSTD_DCtx, dctx_deleter> dctx_;
+    read_function source_;
+    std::vector<char> input_buffer_;
+    ZSTD_inBuffer input_{nullptr, 0, 0};
+    bool frame_complete_{true};
+};
+
+/**
+ * Decompresses gzip data from a stream; concatenated members (as written by
+ * e.g. pigz or `cat a.gz b.gz`) are decoded one after another.
+ */
+class gzip_decoder {
+public:
+    explicit gzip_decoder(read_function source) : source_{std::move(source)}, input_buffer_(1 << 16) {
+        if (inflateInit2(&stream_, 16 + MAX_WBITS) != Z_OK)
+            throw std::runtime_error("Cannot initialize zlib");
+    }
+
+    gzip_decoder(gzip_decoder const &) = delete;
+    gzip_decoder &operator=(gzip_decoder const &) = delete;
+
+    ~gzip_decoder() noexcept { inflateEnd(&stream_); }
+
+    size_t read(char *buf, size_t len) {
+        stream_.next_out = reinterpret_cast<Bytef *>(buf);
+        stream_.avail_out = static_cast<uInt>(std::min<size_t>(len, UINT_MAX));
+        while (stream_.avail_out > 0 && stream_.next_out == reinterpret_cast<Bytef *>(buf)) {
+            if (stream_.avail_in == 0) {
+                auto const n = source_(input_buffer_.data(), input_buffer_.size());
+                if (n == 0) {
+                    if (!member_complete_)
+                        throw std::runtime_error("Truncated gzip input");
+                    break;
+                }
+                stream_.next_in = reinterpret_cast<Bytef *>(input_buffer_.data());
+                stream_.avail_in = static_cast<uInt>(n);
+            }
+            if (member_complete_) {
+                // start of the next member
+                inflateReset(&stream_);
+                member_complete_ = false;
+            }
+            auto const ret = inflate(&stream_, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END)
+                member_complete_ = true;
+            else if (ret != Z_OK && ret != Z_BUF_ERROR)
+                throw std::runtime_error(std::string("zlib: ") + (stream_.msg ? stream_.msg : "inflate failed"));
+        }
+        return static_cast<size_t>(stream_.next_out - reinterpret_cast<Bytef *>(buf));
+    }
+
+private:
+    read_function source_;
+    std::vector<char> input_buffer_;
+    z_stream stream_{};
+    bool member_complete_{true};
+};
+
+/**
+ * @return a read_function which decompresses the data read from source
+ */
+inline auto decompressing_read_function(compression c, read_function source) -> read_function {
+    switch (c) {
+        case compression::zstd:
+            return [decoder = std::make_shared<zstd_decoder>(std::move(source))](char *buf, size_t len) {
+                return decoder->read(buf, len);
+            };
+        case compression::gzip:
+            return [decoder = std::make_shared<gzip_decoder>(std::move(source))](char *buf, size_t len) {
+                return decoder->read(buf, len);
+            };
+        default:
+            return source;
+    }
+}
+
+/**
+ * @return true if data starts with a skippable frame (magic number 0x184D2A5?)
+ */
+inline bool is_skippable_frame(std::string_view data) noexcept {
+    return data.size() >= 4 && (static_cast<uint8_t>(data[0]) & 0xf0) == 0x50 && data[1] == 0x2a && data[2] == 0x4d && data[3] == 0x18;
+}
+
+/**
+ * split zstd compressed data into its frames; skippable frames are dropped
+ * @throw std::runtime_error if the data is not a sequence of complete frames
+ */
+inline auto zstd_frames(std::string_view data) -> std::vector<std::string_view> {
+    std::vector<std::string_view> frames;
+    while (!data.empty()) {
+        auto const len = ZSTD_findFrameCompressedSize(data.data(), data.size());
+        if (ZSTD_isError(len))
+            throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(len));
+        if (!is_skippable_frame(data))
+            frames.push_back(data.substr(0, len));
+        data.remove_prefix(len);
+    }
+    return frames;
+}
+
+#endif //COMPRESSED_INPUT_H
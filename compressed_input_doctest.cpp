@@ -0,0 +1,94 @@
+#include <string>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "compressed_input.h"
+#include <doctest/doctest.h>
+
+static std::string zstd_compress(std::string const & data) {
+    std::string out(ZSTD_compressBound(data.size()), '\0');
+    auto const len = ZSTD_compress(out.data(), out.size(), data.data(), data.size(), 3);
+    CHECK_FALSE(ZSTD_isError(len));
+    out.resize(len);
+    return out;
+}
+
+static std::string gzip_compress(std::string const & data) {
+    z_stream stream{};
+    CHECK(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    std::string out(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    CHECK(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+/** a source which returns data in pieces of at most piece bytes */
+static read_function string_source(std::string data, size_t piece) {
+    return [data = std::move(data), piece, pos = size_t{0}](char *buf, size_t len) mutable {
+        auto const n = std::min({len, piece, data.size() - pos});
+        std::memcpy(buf, data.data() + pos, n);
+        pos += n;
+        return n;
+    };
+}
+
+static std::string read_all(read_function const & source) {
+    std::string result;
+    char buf[1000];
+    while (auto n = source(buf, sizeof(buf)))
+        result.append(buf, n);
+    return result;
+}
+
+TEST_CASE("Check compressed input") {
+    std::string text;
+    for (int i = 0; i < 20'000; ++i)
+        text += "station " + std::to_string(i % 413) + ";" + std::to_string(i % 100) + ".5\n";
+    auto const first = text.substr(0, 12'345);
+    auto const second = text.substr(12'345);
+
+    SUBCASE("detection") {
+        CHECK(detect_compression(zstd_compress(text)) == compression::zstd);
+        CHECK(detect_compression(gzip_compress(text)) == compression::gzip);
+        CHECK(detect_compression(text) == compression::none);
+        CHECK(detect_compression("") == compression::none);
+    }
+    SUBCASE("zstd stream with several frames") {
+        auto const compressed = zstd_compress(first) + zstd_compress(second);
+        CHECK(read_all(decompressing_read_function(compression::zstd, string_source(compressed, 777))) == text);
+    }
+    SUBCASE("zstd frames") {
+        // a skippable frame: magic, size 4, payload
+        std::string const skippable("\x50\x2a\x4d\x18\x04\x00\x00\x00" "abcd", 12);
+        auto const compressed = zstd_compress(first) + skippable + zstd_compress(second);
+        auto const frames = zstd_frames(compressed);
+        REQUIRE(frames.size() == 2);
+        std::string result;
+        for (auto frame : frames) {
+            zstd_decoder decoder(frame);
+            result += read_all([&decoder](char *buf, size_t len) { return decoder.read(buf, len); });
+        }
+        CHECK(result == text);
+        CHECK_THROWS_AS(zstd_frames(compressed.substr(0, compressed.size() - 1)), std::runtime_error);
+    }
+    SUBCASE("truncated zstd stream") {
+        auto const compressed = zstd_compress(text);
+        CHECK_THROWS_AS(read_all(decompressing_read_function(compression::zstd, string_source(compressed.substr(0, compressed.size() / 2), 1000))), std::runtime_error);
+    }
+    SUBCASE("gzip with several members") {
+        auto const compressed = gzip_compress(first) + gzip_compress(second);
+        CHECK(read_all(decompressing_read_function(compression::gzip, string_source(compressed, 333))) == text);
+    }
+    SUBCASE("peeking does not consume") {
+        auto source = std::make_shared<peekable_source>(string_source(gzip_compress(text), 1));
+        CHECK(detect_compression(source->peek(4)) == compression::gzip);
+        auto decompressed = read_all(decompressing_read_function(compression::gzip, [source](char *buf, size_t len) {
+            return source->read(buf, len);
+        }));
+        CHECK(decompressed == text);
+    }
+}
@@ -1,10 +1,25 @@
-#include <math.h>
+/*
+ * Creates measurements.txt for the challenge.
+ *
+ * Every row is a pure function of the seed and its row number: the random
+ * numbers come from a counter-based generator (splitmix64 of seed and counter)
+ * and only exact integer and IEEE double arithmetic is used, so the same
+ * options give the same file on every platform, no matter how many threads
+ * are used. The rows are formatted into one buffer per block of rows and the
+ * blocks are written with pwrite(2) at their offsets in parallel.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-
-#define PI 3.141592654
+#include <unistd.h>
 
 struct {
   char *city;
@@ -425,46 +440,260 @@ struct {
     {"Zürich", 9.3},
 };
 
-double rand_nd(double mean, double stddev) {
-  static double U, V;
-  static int phase = 0;
-  double Z;
+#define NCITIES ((int)(sizeof(data) / sizeof(data[0])))
+#define MAX_NAME_LENGTH 100
+#define BLOCK_ROWS (1 << 16)
+/* longest row: name, ';', "-99.9", '\n' */
+#define MAX_ROW_LENGTH (MAX_NAME_LENGTH + 7)
+
+struct station {
+  char name[MAX_NAME_LENGTH + 1];
+  int name_len;
+  int mean; /* in tenths */
+};
+
+struct options {
+  long rows;
+  uint64_t seed;
+  int stations;
+  int min_name_len;
+  int max_name_len;
+  int threads;
+  const char *output;
+};
+
+static uint64_t mix(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/* the random number nr of the stream of counter; streams never overlap */
+static uint64_t random_at(uint64_t seed, uint64_t counter, unsigned nr) {
+  return mix(mix(seed) + (counter * 16 + nr) * 0x9e3779b97f4a7c15ULL);
+}
+
+/* a uniformly distributed number in [0, n) */
+static uint64_t below(uint64_t random, uint64_t n) {
+  return (uint64_t)(((unsigned __int128)random * n) >> 64);
+}
+
+/* an approximately standard normal value: sum of 12 uniform values - 6 */
+static double normal_at(uint64_t seed, uint64_t counter, unsigned first) {
+  double sum = 0;
+  for (unsigned i = 0; i < 12; i++)
+    sum += (double)(random_at(seed, counter, first + i) >> 11) * 0x1.0p-53;
+  return sum - 6.;
+}
+
+/* the real cities first, then synthetic names; unique by their number and
+ * containing 2 byte UTF-8 characters which are never cut */
+static void make_stations(struct station *stations, struct options const *o) {
+  static const char *umlauts[] = {"ä", "ö", "ü", "é", "ß", "ł", "ñ"};
+  /* synthetic stations use a stream of their own */
+  uint64_t const seed = o->seed ^ 0x53544154494f4e53ULL;
+  for (int i = 0; i < o->stations; i++) {
+    struct station *s = &stations[i];
+    if (i < NCITIES) {
+      s->name_len = (int)strlen(data[i].city);
+      memcpy(s->name, data[i].city, (size_t)s->name_len + 1);
+      s->mean = (int)(data[i].mean * 10 + (data[i].mean < 0 ? -.5 : .5));
+      continue;
+    }
+    unsigned nr = 0;
+    char number[16];
+    int number_len = snprintf(number, sizeof(number), "%d", i);
+    int len = o->min_name_len + (int)below(random_at(seed, (uint64_t)i, nr++),
+                                           (uint64_t)(o->max_name_len - o->min_name_len + 1));
+    if (len < number_len)
+      len = number_len;
+    int pos = 0;
+    while (pos < len - number_len) {
+      uint64_t r = random_at(seed, (uint64_t)i, nr++ % 16);
+      if (below(r, 8) == 0 && pos + 2 <= len - number_len) {
+        memcpy(s->name + pos, umlauts[below(r >> 8, 7)], 2);
+        pos += 2;
+      } else {
+        s->name[pos] = (char)((pos == 0 ? 'A' : 'a') + (int)below(r >> 8, 26));
+        pos++;
+      }
+    }
+    memcpy(s->name + pos, number, (size_t)number_len + 1);
+    s->name_len = pos + number_len;
+    s->mean = (int)below(random_at(seed, (uint64_t)i, 15), 500) - 150;
+  }
+}
+
+static char *format_tenths(char *p, int tenths) {
+  if (tenths < 0) {
+    *p++ = '-';
+    tenths = -tenths;
+  }
+  if (tenths >= 100)
+    *p++ = (char)('0' + tenths / 100);
+  *p++ = (char)('0' + tenths / 10 % 10);
+  *p++ = '.';
+  *p++ = (char)('0' + tenths % 10);
+  return p;
+}
+
+struct job {
+  struct options const *options;
+  struct station const *stations;
+  int fd;
+  atomic_long next_block;
+  /* blocks get their file offsets in order */
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  long offset_block;
+  uint64_t offset;
+  int failed;
+};
+
+static void *generate(void *arg) {
+  struct job *job = arg;
+  struct options const *o = job->options;
+  long const blocks = (o->rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+  char *buffer = malloc((size_t)BLOCK_ROWS * MAX_ROW_LENGTH);
+  if (!buffer) {
+    job->failed = ENOMEM;
+    return NULL;
+  }
+  long block;
+  while ((block = atomic_fetch_add(&job->next_block, 1)) < blocks) {
+    long const first = block * BLOCK_ROWS;
+    long const last = first + BLOCK_ROWS < o->rows ? first + BLOCK_ROWS : o->rows;
+    char *p = buffer;
+    for (long row = first; row < last; row++) {
+      struct station const *s =
+          &job->stations[below(random_at(o->seed, (uint64_t)row, 0), (uint64_t)o->stations)];
+      double value = s->mean + 100. * normal_at(o->seed, (uint64_t)row, 1);
+      int tenths = (int)(value < 0 ? value - .5 : value + .5);
+      tenths = tenths > 999 ? 999 : tenths < -999 ? -999 : tenths;
+      memcpy(p, s->name, (size_t)s->name_len);
+      p += s->name_len;
+      *p++ = ';';
+      p = format_tenths(p, tenths);
+      *p++ = '\n';
+    }
+    size_t const len = (size_t)(p - buffer);
 
-  if (phase == 0) {
-    U = (rand() + 1.) / (RAND_MAX + 2.);
-    V = rand() / (RAND_MAX + 1.);
-    Z = sqrt(-2 * log(U)) * sin(2 * PI * V);
-  } else {
-    Z = sqrt(-2 * log(U)) * cos(2 * PI * V);
+    pthread_mutex_lock(&job->mutex);
+    while (job->offset_block != block)
+      pthread_cond_wait(&job->cond, &job->mutex);
+    uint64_t const offset = job->offset;
+    job->offset += len;
+    job->offset_block++;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->mutex);
+
+    for (size_t done = 0; done < len;) {
+      ssize_t n = pwrite(job->fd, buffer + done, len - done, (off_t)(offset + done));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        job->failed = errno;
+        break;
+      }
+      done += (size_t)n;
+    }
   }
-  phase = 1 - phase;
+  free(buffer);
+  return NULL;
+}
+
+static int parse_name_length(const char *arg, struct options *o) {
+  char *end;
+  o->min_name_len = (int)strtol(arg, &end, 10);
+  o->max_name_len = *end == '-' ? (int)strtol(end + 1, &end, 10) : o->min_name_len;
+  return *end == '\0' && o->min_name_len >= 1 && o->min_name_len <= o->max_name_len &&
+         o->max_name_len <= MAX_NAME_LENGTH;
+}
 
-  return Z * stddev + mean;
+static void usage(FILE *out) {
+  fprintf(out,
+          "usage: create-sample [options] <amount>\n"
+          "  -o, --output PATH        file to write [measurements.txt]\n"
+          "  -s, --seed N             seed of the random numbers [1]\n"
+          "  -n, --stations N         number of stations; those beyond the %d real\n"
+          "                           cities get synthetic names [%d]\n"
+          "  -l, --name-length MIN[-MAX]\n"
+          "                           synthetic names are uniformly distributed\n"
+          "                           between MIN and MAX bytes long [1-100]\n"
+          "  -t, --threads N          number of threads [number of processors]\n",
+          NCITIES, NCITIES);
 }
 
 int main(int argc, char **argv) {
-  if (argc <= 1) {
-    printf("usage: create-sample <amount>\n");
+  struct options o = {0, 1, NCITIES, 1, MAX_NAME_LENGTH, 0, "measurements.txt"};
+  static struct option const long_options[] = {
+      {"output", required_argument, NULL, 'o'},  {"seed", required_argument, NULL, 's'},
+      {"stations", required_argument, NULL, 'n'}, {"name-length", required_argument, NULL, 'l'},
+      {"threads", required_argument, NULL, 't'}, {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}};
+  int opt;
+  while ((opt = getopt_long(argc, argv, "o:s:n:l:t:h", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'o': o.output = optarg; break;
+    case 's': o.seed = strtoull(optarg, NULL, 0); break;
+    case 'n': o.stations = (int)strtol(optarg, NULL, 10); break;
+    case 'l':
+      if (!parse_name_length(optarg, &o)) {
+        fprintf(stderr, "name length must be MIN or MIN-MAX within 1 to %d\n", MAX_NAME_LENGTH);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 't': o.threads = (int)strtol(optarg, NULL, 10); break;
+    case 'h': usage(stdout); exit(EXIT_SUCCESS);
+    default: usage(stderr); exit(EXIT_FAILURE);
+    }
+  }
+  if (optind >= argc) {
+    usage(stdout);
     exit(EXIT_SUCCESS);
   }
-
-  FILE *fh = fopen("measurements.txt", "w");
-  if (!fh) {
-    printf("error creating file\n");
+  o.rows = strtol(argv[optind], NULL, 10);
+  if (o.rows < 0 || o.stations < 1) {
+    fprintf(stderr, "amount must not be negative and stations must be positive\n");
     exit(EXIT_FAILURE);
   }
+  if (o.threads < 1)
+    o.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
 
-  clock_t tstart = clock();
+  struct timespec tstart, tend;
+  clock_gettime(CLOCK_MONOTONIC, &tstart);
 
-  long n = strtol(argv[1], NULL, 10);
-  int ncities = sizeof(data) / sizeof(data[0]);
-  for (int i = 0; i < n; i++) {
-    int c = rand() % ncities;
-    double measurement = rand_nd(data[c].mean, 10);
-    fprintf(fh, "%s;%.1f\n", data[c].city, measurement);
+  struct station *stations = malloc((size_t)o.stations * sizeof(struct station));
+  if (!stations) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
   }
+  make_stations(stations, &o);
 
-  fclose(fh);
-  printf("Created %ld measurements in %f ms\n", n,
-         (double)(clock() - tstart) * 1000 / (double)CLOCKS_PER_SEC);
-}
\ No newline at end of file
+  int fd = open(o.output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    perror(o.output);
+    exit(EXIT_FAILURE);
+  }
+  struct job job = {.options = &o, .stations = stations, .fd = fd};
+  atomic_init(&job.next_block, 0);
+  pthread_mutex_init(&job.mutex, NULL);
+  pthread_cond_init(&job.cond, NULL);
+  pthread_t *threads = malloc((size_t)o.threads * sizeof(pthread_t));
+  for (int i = 0; i < o.threads; i++)
+    pthread_create(&threads[i], NULL, generate, &job);
+  for (int i = 0; i < o.threads; i++)
+    pthread_join(threads[i], NULL);
+  if (job.failed || close(fd) != 0) {
+    fprintf(stderr, "%s: %s\n", o.output, strerror(job.failed ? job.failed : errno));
+    exit(EXIT_FAILURE);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &tend);
+  printf("Created %ld measurements of %d stations (%llu bytes) in %f ms\n", o.rows, o.stations,
+         (unsigned long long)job.offset,
+         (double)(tend.tv_sec - tstart.tv_sec) * 1000 + (double)(tend.tv_nsec - tstart.tv_nsec) / 1e6);
+  free(threads);
+  free(stations);
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include "delimiter_scanner.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+constexpr uint64_t broadcast(char c) noexcept { return 0x0101010101010101ULL * static_cast<unsigned char>(c); }
+
+// high bit of every byte of the result is set iff the corresponding byte of x is zero (exact, no carries)
+constexpr uint64_t zero_bytes(uint64_t x) noexcept {
+    constexpr uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    return ~(((x & low7) + low7) | x | low7);
+}
+}
+
+uint64_t delimiter_mask_swar(char const *block) noexcept {
+    uint64_t mask = 0;
+    for (size_t w = 0; w < DELIMITER_BLOCK_SIZE / 8; ++w) {
+        uint64_t word;
+        std::memcpy(&word, block + 8 * w, 8);
+        uint64_t const hits = zero_bytes(word ^ broadcast(';')) | zero_bytes(word ^ broadcast('\n'));
+        // gather the high bit of each byte into the top byte
+        uint64_t const bits = ((hits >> 7) * 0x0102040810204080ULL) >> 56;
+        mask |= bits << (8 * w);
+    }
+    return mask;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+uint64_t delimiter_mask_sse2(char const *block) noexcept {
+    __m128i const semicolon = _mm_set1_epi8(';');
+    __m128i const newline = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(block + 16 * i));
+        __m128i const hits = _mm_or_si128(_mm_cmpeq_epi8(v, semicolon), _mm_cmpeq_epi8(v, newline));
+        mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(hits))) << (16 * i);
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t delimiter_mask_avx2(char const *block) noexcept {
+    __m256i const semicolon = _mm256_set1_epi8(';');
+    __m256i const newline = _mm256_set1_epi8('\n');
+    __m256i const lo = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(block));
+    __m256i const hi = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(block + 32));
+    __m256i const hits_lo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, semicolon), _mm256_cmpeq_epi8(lo, newline));
+    __m256i const hits_hi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, semicolon), _mm256_cmpeq_epi8(hi, newline));
+    return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hits_lo)))
+        | (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hits_hi))) << 32);
+}
+#endif
+
+namespace {
+struct kernel_choice {
+    delimiter_kernel_fn fn_;
+    char const *name_;
+};
+
+kernel_choice const &choose_kernel() noexcept {
+    static kernel_choice const choice = []() -> kernel_choice {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return {&delimiter_mask_avx2, "avx2"};
+        if (__builtin_cpu_supports("sse2"))
+            return {&delimiter_mask_sse2, "sse2"};
+#endif
+        return {&delimiter_mask_swar, "swar"};
+    }();
+    return choice;
+}
+}
+
+delimiter_kernel_fn active_delimiter_kernel() noexcept {
+    return choose_kernel().fn_;
+}
+
+char const *active_delimiter_kernel_name() noexcept {
+    return choose_kernel().name_;
+}
@@ -0,0 +1,83 @@
+#ifndef DELIMITER_SCANNER_H
+#define DELIMITER_SCANNER_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * A delimiter kernel returns a bitmask of the positions of all field (';')
+ * and line ('\n') delimiters within the DELIMITER_BLOCK_SIZE bytes starting
+ * at block: bit i is set iff block[i] is a delimiter.
+ */
+static constexpr size_t DELIMITER_BLOCK_SIZE = 64;
+
+using delimiter_kernel_fn = uint64_t (*)(char const *block) noexcept;
+
+/** portable kernel working on 8 bytes at a time in general purpose registers */
+uint64_t delimiter_mask_swar(char const *block) noexcept;
+
+#if defined(__x86_64__) || defined(__i386__)
+uint64_t delimiter_mask_sse2(char const *block) noexcept;
+uint64_t delimiter_mask_avx2(char const *block) noexcept;
+#endif
+
+/**
+ * @return the fastest kernel supported by the executing CPU (determined once via CPUID)
+ */
+delimiter_kernel_fn active_delimiter_kernel() noexcept;
+
+/**
+ * @return name of the kernel returned by active_delimiter_kernel()
+ */
+char const *active_delimiter_kernel_name() noexcept;
+
+/**
+ * Iterate over the positions of all delimiters in a string_view, one block of
+ * DELIMITER_BLOCK_SIZE bytes at a time. The trailing bytes which do not fill a
+ * complete block are scanned one by one, so nothing is read past the end of
+ * the view.
+ */
+class delimiter_scanner {
+public:
+    static constexpr size_t npos = std::string_view::npos;
+
+    delimiter_scanner(std::string_view sv, size_t pos, delimiter_kernel_fn kernel = active_delimiter_kernel()) noexcept
+        : data_{sv.data()}, size_{sv.size()}, base_{pos}, kernel_{kernel} {
+        mask_ = load(base_);
+    }
+
+    /**
+     * @return position of the next delimiter or npos if there is none left
+     */
+    size_t next() noexcept {
+        while (mask_ == 0) {
+            base_ += DELIMITER_BLOCK_SIZE;
+            if (base_ >= size_)
+                return npos;
+            mask_ = load(base_);
+        }
+        size_t const pos = base_ + static_cast<size_t>(std::countr_zero(mask_));
+        mask_ &= mask_ - 1;
+        return pos;
+    }
+
+private:
+    uint64_t load(size_t base) const noexcept {
+        if (base + DELIMITER_BLOCK_SIZE <= size_)
+            return kernel_(data_ + base);
+        uint64_t mask = 0;
+        for (size_t i = base; i < size_; ++i)
+            mask |= static_cast<uint64_t>(data_[i] == ';' || data_[i] == '\n') << (i - base);
+        return mask;
+    }
+
+    char const *data_;
+    size_t size_;
+    size_t base_;
+    uint64_t mask_{0};
+    delimiter_kernel_fn kernel_;
+};
+
+#endif //DELIMITER_SCANNER_H
@@ -0,0 +1,70 @@
+#include <random>
+#include <string>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "delimiter_scanner.h"
+#include <doctest/doctest.h>
+
+namespace {
+auto scalar_positions(std::string_view sv, size_t pos) -> std::vector<size_t> {
+    std::vector<size_t> result;
+    for (size_t i = pos; i < sv.size(); ++i)
+        if (sv[i] == ';' || sv[i] == '\n')
+            result.push_back(i);
+    return result;
+}
+
+auto scanner_positions(std::string_view sv, size_t pos, delimiter_kernel_fn kernel) -> std::vector<size_t> {
+    std::vector<size_t> result;
+    delimiter_scanner scanner(sv, pos, kernel);
+    for (size_t d = scanner.next(); d != delimiter_scanner::npos; d = scanner.next())
+        result.push_back(d);
+    return result;
+}
+
+auto all_kernels() -> std::vector<delimiter_kernel_fn> {
+    std::vector<delimiter_kernel_fn> kernels{&delimiter_mask_swar, active_delimiter_kernel()};
+#if defined(__x86_64__) || defined(__i386__)
+    kernels.push_back(&delimiter_mask_sse2);
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back(&delimiter_mask_avx2);
+#endif
+    return kernels;
+}
+}
+
+TEST_CASE("Check delimiter kernels") {
+    SUBCASE("single delimiter at every position of a block") {
+        for (auto kernel : all_kernels()) {
+            for (size_t i = 0; i < DELIMITER_BLOCK_SIZE; ++i) {
+                std::string block(DELIMITER_BLOCK_SIZE, 'a');
+                block[i] = ';';
+                CHECK(kernel(block.data()) == (uint64_t{1} << i));
+                block[i] = '\n';
+                CHECK(kernel(block.data()) == (uint64_t{1} << i));
+            }
+        }
+    }
+    SUBCASE("bytes close to the delimiters do not match") {
+        std::string block(DELIMITER_BLOCK_SIZE, '\0');
+        for (size_t i = 0; i < block.size(); ++i)
+            block[i] = static_cast<char>(";\n:<\x0b\x09\xbb\x8a"[i % 8]);
+        for (auto kernel : all_kernels())
+            CHECK(kernel(block.data()) == 0x0303030303030303ULL);
+    }
+}
+
+TEST_CASE("Check delimiter_scanner") {
+    std::mt19937_64 rnd{4711};
+    static constexpr char alphabet[] = "ab;\n\xc3\xbc.-";
+    for (size_t len : {0, 1, 63, 64, 65, 127, 128, 1000, 4099}) {
+        std::string input(len, ' ');
+        for (auto & c : input)
+            c = alphabet[rnd() % (sizeof(alphabet) - 1)];
+        for (size_t pos : {size_t{0}, size_t{1}, size_t{17}, len / 2, len}) {
+            auto expected = scalar_positions(input, pos);
+            for (auto kernel : all_kernels())
+                CHECK(scanner_positions(input, pos, kernel) == expected);
+        }
+    }
+}
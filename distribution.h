@@ -0,0 +1,132 @@
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * The distribution of the values of one station: an exact histogram of the
+ * tenths of the challenge range and the sum of squares, from which the
+ * standard deviation and percentiles are derived.
+ *
+ * Values of the challenge are bounded (-99.9..99.9), so a counter per tenth
+ * (1999 slots) gives exact percentiles with a single increment per value and
+ * distributions are combined by adding the counters. Values outside that
+ * range are counted in one slot below and one above it; percentiles falling
+ * into these are answered with the minimum or maximum of the station.
+ *
+ * The counters are single bytes, so that the distributions of a few hundred
+ * stations stay in the L2 cache (2KB each, per station and thread). When a
+ * counter wraps around, the carry goes into a second array of 32 bit counters,
+ * which is allocated at the first carry and only touched every 256th time.
+ */
+class distribution {
+public:
+    static constexpr int64_t MIN_TENTHS = -999;
+    static constexpr int64_t MAX_TENTHS = 999;
+    static constexpr size_t SLOTS = MAX_TENTHS - MIN_TENTHS + 1 + 2; // + below and above the range
+
+    distribution() = default;
+
+    distribution(distribution const & other)
+        : sum_squares_{other.sum_squares_}, low_{other.low_},
+          high_{other.high_ ? std::make_unique<std::array<uint32_t, SLOTS>>(*other.high_) : nullptr} {
+    }
+
+    distribution(distribution &&) noexcept = default;
+    distribution &operator=(distribution const &) = delete;
+    distribution &operator=(distribution &&) noexcept = default;
+
+    void add(int64_t tenths) {
+        auto const s = slot(tenths);
+        if (++low_[s] == 0) [[unlikely]]
+            carry(s, 1);
+        sum_squares_ += tenths * tenths;
+    }
+
+    void combine(distribution const & other) {
+        for (size_t s = 0; s < SLOTS; ++s) {
+            unsigned const sum = unsigned{low_[s]} + other.low_[s];
+            low_[s] = static_cast<uint8_t>(sum);
+            if (sum > UINT8_MAX)
+                carry(s, 1);
+        }
+        if (other.high_) {
+            for (size_t s = 0; s < SLOTS; ++s)
+                if ((*other.high_)[s] != 0)
+                    carry(s, (*other.high_)[s]);
+        }
+        sum_squares_ += other.sum_squares_;
+    }
+
+    /**
+     * @return the sum of the squares of all values in tenths
+     */
+    [[nodiscard]] int64_t sum_squares() const noexcept { return sum_squares_; }
+
+    /**
+     * @return the number of values with the given tenths, or of all values below
+     * (MIN_TENTHS - 1) or above (MAX_TENTHS + 1) the range
+     */
+    [[nodiscard]] uint64_t count(int64_t tenths) const noexcept { return count_of(slot(tenths)); }
+
+    /**
+     * population standard deviation in tenths
+     * @param sum sum of all values in tenths
+     * @param cnt number of values
+     */
+    [[nodiscard]] double stddev_tenths(double sum, uint64_t cnt) const noexcept {
+        auto const n = static_cast<double>(cnt);
+        auto const mean = sum / n;
+        return std::sqrt(std::max(0., static_cast<double>(sum_squares_) / n - mean * mean));
+    }
+
+    /**
+     * nearest-rank percentile: the smallest value such that at least p percent of
+     * all values are less or equal
+     * @param p in (0, 100]
+     * @param min_tenths answer for percentiles below the range
+     * @param max_tenths answer for percentiles above the range
+     * @return the percentile in tenths
+     */
+    [[nodiscard]] int64_t percentile_tenths(double p, uint64_t cnt, int64_t min_tenths, int64_t max_tenths) const noexcept {
+        auto const rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100. * static_cast<double>(cnt))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < SLOTS; ++i) {
+            seen += count_of(i);
+            if (seen >= rank) {
+                if (i == 0)
+                    return min_tenths;
+                if (i == SLOTS - 1)
+                    return max_tenths;
+                return static_cast<int64_t>(i) - 1 + MIN_TENTHS;
+            }
+        }
+        return max_tenths;
+    }
+
+private:
+    static size_t slot(int64_t tenths) noexcept {
+        return static_cast<size_t>(std::clamp(tenths, MIN_TENTHS - 1, MAX_TENTHS + 1) - (MIN_TENTHS - 1));
+    }
+
+    [[nodiscard]] uint64_t count_of(size_t s) const noexcept {
+        return low_[s] + (high_ ? uint64_t{(*high_)[s]} << 8 : 0);
+    }
+
+    void carry(size_t s, uint32_t n) {
+        if (!high_)
+            high_ = std::make_unique<std::array<uint32_t, SLOTS>>();
+        (*high_)[s] += n;
+    }
+
+    int64_t sum_squares_{0};
+    std::array<uint8_t, SLOTS> low_{};
+    std::unique_ptr<std::array<uint32_t, SLOTS>> high_; // carries of low_, i.e. multiples of 256
+};
+
+#endif //DISTRIBUTION_H
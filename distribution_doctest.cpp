@@ -0,0 +1,44 @@
+#include <cstdint>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "distribution.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check distribution") {
+    distribution d;
+    for (int64_t t = 1; t <= 100; ++t)
+        d.add(t);
+    CHECK(d.count(1) == 1);
+    CHECK(d.count(0) == 0);
+    CHECK(d.sum_squares() == 338350);
+    CHECK(d.percentile_tenths(50, 100, 1, 100) == 50);
+    CHECK(d.percentile_tenths(95, 100, 1, 100) == 95);
+    CHECK(d.percentile_tenths(99, 100, 1, 100) == 99);
+    CHECK(d.percentile_tenths(100, 100, 1, 100) == 100);
+    CHECK(d.percentile_tenths(0.1, 100, 1, 100) == 1);
+    // values 0.1 to 10.0: variance (100^2 - 1) / 12 tenths^2
+    CHECK(d.stddev_tenths(5050, 100) == doctest::Approx(28.866).epsilon(0.001));
+
+    SUBCASE("counters carry") {
+        distribution c(d);
+        for (int i = 0; i < 1000; ++i)
+            c.add(-999);
+        CHECK(c.count(-999) == 1000);
+        distribution copy(c);
+        c.combine(copy);
+        CHECK(c.count(-999) == 2000);
+        CHECK(c.count(50) == 2);
+        CHECK(copy.count(-999) == 1000);
+        CHECK(c.percentile_tenths(50, 2200, -999, 100) == -999);
+    }
+    SUBCASE("values out of range") {
+        distribution o(d);
+        o.add(-1500);
+        o.add(2000);
+        o.add(2001);
+        CHECK(o.count(-1000) == 1);
+        CHECK(o.count(1000) == 2);
+        CHECK(o.percentile_tenths(0.5, 103, -1500, 2001) == -1500);
+        CHECK(o.percentile_tenths(99, 103, -1500, 2001) == 2001);
+        CHECK(o.percentile_tenths(50, 103, -1500, 2001) == 51);
+    }
+}
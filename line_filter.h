@@ -0,0 +1,233 @@
+#ifndef LINE_FILTER_H
+#define LINE_FILTER_H
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "station_table.h"
+#include "statistics.h"
+
+/**
+ * How a value is compared in a predicate like temp>30.
+ */
+enum class comparison {
+    less,
+    less_equal,
+    greater,
+    greater_equal,
+    equal
+};
+
+/**
+ * value column op threshold, e.g. temp>30
+ */
+struct predicate {
+    size_t column_;
+    comparison op_;
+    double threshold_;
+};
+
+/**
+ * @param expr NAME OP NUMBER with OP one of <, <=, >, >=, = or ==, e.g. temp>30 or humidity <= 80.5
+ * @param columns names of the value columns
+ * @return the predicate or nothing if expr has another form or names no column
+ */
+inline auto parse_predicate(std::string_view expr, std::vector<std::string> const & columns) -> std::optional<predicate> {
+    auto trim = [](std::string_view s) {
+        while (!s.empty() && s.front() == ' ')
+            s.remove_prefix(1);
+        while (!s.empty() && s.back() == ' ')
+            s.remove_suffix(1);
+        return s;
+    };
+    auto const op_start = expr.find_first_of("<>=");
+    if (op_start == std::string_view::npos)
+        return {};
+    auto const name = trim(expr.substr(0, op_start));
+    auto const column = std::find(columns.begin(), columns.end(), name);
+    if (column == columns.end())
+        return {};
+    auto rest = expr.substr(op_start);
+    comparison op;
+    if (rest.starts_with("<=")) {
+        op = comparison::less_equal;
+        rest.remove_prefix(2);
+    } else if (rest.starts_with(">=")) {
+        op = comparison::greater_equal;
+        rest.remove_prefix(2);
+    } else if (rest.starts_with("==")) {
+        op = comparison::equal;
+        rest.remove_prefix(2);
+    } else {
+        op = rest[0] == '<' ? comparison::less : rest[0] == '>' ? comparison::greater : comparison::equal;
+        rest.remove_prefix(1);
+    }
+    rest = trim(rest);
+    double threshold;
+    auto [ptr, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), threshold);
+    if (rest.empty() || ec != std::errc{} || ptr != rest.data() + rest.size() || !std::isfinite(threshold))
+        return {};
+    return predicate{static_cast<size_t>(column - columns.begin()), op, threshold};
+}
+
+/**
+ * Filters the lines while they are scanned, before their station is looked
+ * up in the table: an allowlist of stations and predicates on the values.
+ *
+ * The allowlist is checked with the hash of the name which the scanner
+ * computes anyway. A blocked bloom filter of 16 bits per station (three bits
+ * within a single 64 bit word) rejects almost all other stations with one
+ * load from a small array; only names passing it are looked up in a table of
+ * the allowed names. The values of rejected lines are not even parsed.
+ *
+ * The predicates are turned into an inclusive range per value column in the
+ * representation of the statistics (e.g. temp>30 into temp >= 30.1 for
+ * integer tenths), so a line costs one or two integer compares per column.
+ *
+ * @tparam Stats statistics, see basic_statistics; its values are compared
+ */
+template<typename Stats>
+class basic_line_filter {
+public:
+    using value_type = typename Stats::value_type;
+
+    basic_line_filter() = default;
+
+    /**
+     * keep only the lines of these stations; may be called once
+     */
+    void allow_stations(std::vector<std::string> const & names) {
+        size_t words = 1;
+        while (words * 64 < 16 * names.size())
+            words *= 2;
+        bloom_.assign(words, 0);
+        stations_.reserve(names.size());
+        for (auto const & name : names) {
+            auto const hash = station_table<bool>::hash_key(name);
+            bloom_[bloom_word(hash)] |= bloom_bits(hash);
+            stations_.try_emplace(hashed_key{name, hash}, true);
+        }
+        has_stations_ = true;
+    }
+
+    /**
+     * keep only the lines whose value in the column of p satisfies it, too
+     */
+    void add_predicate(predicate const & p) {
+        if (bounds_.size() <= p.column_)
+            bounds_.resize(p.column_ + 1);
+        auto & b = bounds_[p.column_];
+        auto const [low, high] = range_of(p);
+        b.low_ = std::max(b.low_, low);
+        b.high_ = std::min(b.high_, high);
+    }
+
+    [[nodiscard]] bool has_stations() const noexcept { return has_stations_; }
+
+    /**
+     * @return the number of value columns the predicates refer to
+     */
+    [[nodiscard]] size_t columns() const noexcept { return bounds_.size(); }
+
+    /**
+     * @param hash the hash of name as computed by station_table
+     */
+    [[nodiscard]] bool accepts_station(std::string_view name, size_t hash) const noexcept {
+        if (!has_stations_)
+            return true;
+        auto const bits = bloom_bits(hash);
+        if ((bloom_[bloom_word(hash)] & bits) != bits)
+            return false;
+        return stations_.find(hashed_key{name, hash}) != nullptr;
+    }
+
+    /**
+     * @param values one value per column, at least columns()
+     */
+    [[nodiscard]] bool accepts_values(value_type const * values) const noexcept {
+        for (size_t c = 0; c < bounds_.size(); ++c)
+            if (values[c] < bounds_[c].low_ || values[c] > bounds_[c].high_)
+                return false;
+        return true;
+    }
+
+private:
+    // integer values are compared as int64_t so that thresholds beyond their range stay exact
+    using bound_type = std::conditional_t<std::is_floating_point_v<value_type>, value_type, int64_t>;
+
+    struct bounds {
+        bound_type low_{std::numeric_limits<bound_type>::lowest()};
+        bound_type high_{std::numeric_limits<bound_type>::max()};
+    };
+
+    static auto range_of(predicate const & p) noexcept -> std::pair<bound_type, bound_type> {
+        constexpr auto lowest = std::numeric_limits<bound_type>::lowest();
+        constexpr auto max = std::numeric_limits<bound_type>::max();
+        bound_type floor, ceil;
+        if constexpr (std::is_floating_point_v<value_type>) {
+            floor = ceil = static_cast<value_type>(p.threshold_ * Stats::scale);
+        } else {
+            // thresholds like 30.1 are not exact in binary; snap them to the nearest step of the values
+            auto scaled = std::clamp(p.threshold_ * Stats::scale, -1e18, 1e18);
+            if (std::abs(scaled - std::round(scaled)) < 1e-6)
+                scaled = std::round(scaled);
+            floor = static_cast<bound_type>(std::floor(scaled));
+            ceil = static_cast<bound_type>(std::ceil(scaled));
+        }
+        switch (p.op_) {
+            case comparison::less:
+                return {lowest, below(ceil)};
+            case comparison::less_equal:
+                return {lowest, floor};
+            case comparison::greater:
+                return {above(floor), max};
+            case comparison::greater_equal:
+                return {ceil, max};
+            case comparison::equal:
+                break;
+        }
+        return {ceil, floor};
+    }
+
+    static bound_type below(bound_type v) noexcept {
+        if constexpr (std::is_floating_point_v<bound_type>)
+            return std::nextafter(v, std::numeric_limits<bound_type>::lowest());
+        else
+            return v - 1;
+    }
+
+    static bound_type above(bound_type v) noexcept {
+        if constexpr (std::is_floating_point_v<bound_type>)
+            return std::nextafter(v, std::numeric_limits<bound_type>::max());
+        else
+            return v + 1;
+    }
+
+    [[nodiscard]] size_t bloom_word(size_t hash) const noexcept {
+        return static_cast<size_t>(static_cast<uint64_t>(hash) >> 32) & (bloom_.size() - 1);
+    }
+
+    static uint64_t bloom_bits(size_t hash) noexcept {
+        auto const h = static_cast<uint64_t>(hash);
+        return uint64_t{1} << (h & 63) | uint64_t{1} << (h >> 6 & 63) | uint64_t{1} << (h >> 12 & 63);
+    }
+
+    bool has_stations_{false};
+    std::vector<uint64_t> bloom_;
+    station_table<bool> stations_{16};
+    std::vector<bounds> bounds_; // per value column; columns without predicates accept everything
+};
+
+using line_filter = basic_line_filter<column_statistics>;
+
+#endif //LINE_FILTER_H
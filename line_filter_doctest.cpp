@@ -0,0 +1,91 @@
+#include <string>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "line_filter.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check predicate parsing") {
+    std::vector<std::string> const columns{"temp", "humidity"};
+    auto p = parse_predicate("temp>30", columns);
+    REQUIRE(p);
+    CHECK(p->column_ == 0);
+    CHECK(p->op_ == comparison::greater);
+    CHECK(p->threshold_ == 30.);
+    p = parse_predicate(" humidity <= -80.5 ", columns);
+    REQUIRE(p);
+    CHECK(p->column_ == 1);
+    CHECK(p->op_ == comparison::less_equal);
+    CHECK(p->threshold_ == -80.5);
+    CHECK(parse_predicate("temp>=1", columns)->op_ == comparison::greater_equal);
+    CHECK(parse_predicate("temp<1", columns)->op_ == comparison::less);
+    CHECK(parse_predicate("temp=1", columns)->op_ == comparison::equal);
+    CHECK(parse_predicate("temp==1", columns)->op_ == comparison::equal);
+
+    CHECK_FALSE(parse_predicate("temp", columns));
+    CHECK_FALSE(parse_predicate("pressure>1", columns));
+    CHECK_FALSE(parse_predicate("temp>", columns));
+    CHECK_FALSE(parse_predicate("temp>1x", columns));
+    CHECK_FALSE(parse_predicate("temp!=1", columns));
+    CHECK_FALSE(parse_predicate("temp<>1", columns));
+    CHECK_FALSE(parse_predicate("temp>nan", columns));
+}
+
+TEST_CASE("Check value predicates") {
+    using value_type = fixed_statistics::value_type;
+    auto accepts = [](comparison op, double threshold, int16_t tenths) {
+        basic_line_filter<fixed_statistics> filter;
+        filter.add_predicate(predicate{0, op, threshold});
+        value_type const value = fixed_statistics::from_tenths(tenths);
+        return filter.accepts_values(&value);
+    };
+    CHECK(accepts(comparison::greater, 30, 301));
+    CHECK_FALSE(accepts(comparison::greater, 30, 300));
+    CHECK(accepts(comparison::greater_equal, 30.1, 301));
+    CHECK_FALSE(accepts(comparison::greater_equal, 30.1, 300));
+    CHECK(accepts(comparison::less, 30.1, 300));
+    CHECK_FALSE(accepts(comparison::less, 30.1, 301));
+    CHECK(accepts(comparison::less_equal, -5.05, -51));
+    CHECK_FALSE(accepts(comparison::less_equal, -5.05, -50));
+    CHECK(accepts(comparison::greater, -5.05, -50));
+    CHECK_FALSE(accepts(comparison::greater, -5.05, -51));
+    CHECK(accepts(comparison::equal, 12.3, 123));
+    CHECK_FALSE(accepts(comparison::equal, 12.3, 124));
+    CHECK_FALSE(accepts(comparison::equal, 12.35, 123));
+    CHECK_FALSE(accepts(comparison::greater, 1e9, 999));
+    CHECK(accepts(comparison::greater, -1e30, -999));
+
+    SUBCASE("several columns") {
+        basic_line_filter<fixed_statistics> filter;
+        filter.add_predicate(predicate{0, comparison::greater_equal, -10});
+        filter.add_predicate(predicate{0, comparison::less, 0});
+        filter.add_predicate(predicate{2, comparison::greater, 50});
+        CHECK(filter.columns() == 3);
+        value_type const inside[] = {-100, 12345, 501};
+        value_type const too_warm[] = {0, 0, 501};
+        value_type const too_dry[] = {-1, 0, 500};
+        CHECK(filter.accepts_values(inside));
+        CHECK_FALSE(filter.accepts_values(too_warm));
+        CHECK_FALSE(filter.accepts_values(too_dry));
+    }
+}
+
+TEST_CASE("Check station allowlist") {
+    line_filter filter;
+    CHECK_FALSE(filter.has_stations());
+    CHECK(filter.accepts_station("Abha", station_table<bool>::hash_key("Abha")));
+
+    std::vector<std::string> allowed;
+    for (int i = 0; i < 300; ++i)
+        allowed.push_back("Station " + std::to_string(i));
+    allowed.emplace_back("A station with a name longer than thirty two bytes");
+    filter.allow_stations(allowed);
+    CHECK(filter.has_stations());
+    for (auto const & name : allowed)
+        CHECK(filter.accepts_station(name, station_table<bool>::hash_key(name)));
+    for (int i = 300; i < 20000; ++i) {
+        auto const name = "Station " + std::to_string(i);
+        CHECK_FALSE(filter.accepts_station(name, station_table<bool>::hash_key(name)));
+    }
+    CHECK_FALSE(filter.accepts_station("Station", station_table<bool>::hash_key("Station")));
+    CHECK_FALSE(filter.accepts_station("", station_table<bool>::hash_key("")));
+}
@@ -1,175 +1,187 @@
 // https://1brc.dev/#the-challenge
-#include <atomic>
-#include <clocale>
-#include <exception>
-#include <future>
-#include <stdexcept>
-
 #include <algorithm>
-#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
-#include <map>
+#include <string_view>
 #include <thread>
-#include <unordered_map>
+#include <unistd.h>
 #include <vector>
-//#include <pstl/glue_numeric_defs.h>
 #include <fmt/core.h>
 #include <argparse/argparse.hpp>
 
-#include "mmapped_file.h"
-#include "statistics.h"
-#include "simple_parse_float.h"
-
-/** Input File; UTF-8, UNIX line breaks 0x0a
-00000000  4b 61 6e 73 61 73 20 43  69 74 79 3b 2d 30 2e 38  |Kansas City;-0.8|
-00000010  0a 44 61 6d 61 73 63 75  73 3b 31 39 2e 38 0a 4b  |.Damascus;19.8.K|
-00000020  61 6e 73 61 73 20 43 69  74 79 3b 32 38 2e 30 0a  |ansas City;28.0.|
-00000030  4c 61 20 43 65 69 62 61  3b 31 37 2e 30 0a 44 61  |La Ceiba;17.0.Da|
-00000040  72 77 69 6e 3b 32 39 2e  31 0a 4e 65 77 20 59 6f  |rwin;29.1.New Yo|
-00000050  72 6b 20 43 69 74 79 3b  32 2e 31 0a 4c 69 73 62  |rk City;2.1.Lisb|
-...
-*/
+#include "aggregator.h"
+#include "compressed_input.h"
+#include "line_filter.h"
+#include "result_output.h"
+#include "run_stats.h"
+#include "snapshot.h"
 
+static constexpr int ERROR_ARGS = 1;
+static constexpr int ERROR_FILE_FORMAT = 2;
+static constexpr int ERROR_OTHER = 3;
 
-struct simple_hasher {
-    size_t operator()(void const *ptr, size_t len) {
-        auto seed = static_cast<size_t>(0xc70f6907UL);
-        auto const c = static_cast<unsigned char const *>(ptr);
-        for (size_t i = 0; i < len; ++i)
-            seed = 31 * seed + c[i];
-        return seed;
-    }
-    size_t operator()(std::string_view const & sv) {
-        return this->operator()(sv.data(), sv.length());
-    }
-};
-
-struct string_hash {
-    //using hash_type = std::hash<std::string_view>;
-    using hash_type = simple_hasher;
-    using is_transparent = void;
-
-    std::size_t operator()(const char *str) const { return hash_type{}(str); }
-    std::size_t operator()(std::string_view str) const { return hash_type{}(str); }
-    std::size_t operator()(std::string const &str) const { return hash_type{}(str); }
+/**
+ * What a run with --snapshot processes: the complete lines from begin_ to
+ * end_ of the file, combined with the snapshot of a previous run if any.
+ * A last line without new-line from end_ to size_ may still be being
+ * written; it is added to the output, but not to the snapshot.
+ */
+struct snapshot_plan {
+    size_t begin_{0};
+    size_t end_{0};
+    size_t size_{0};
+    uint64_t fingerprint_{0}; // of the file up to end_
+    std::optional<snapshot> previous_;
 };
 
-using agg_map_type = std::unordered_map<std::string, statistics, string_hash, std::equal_to<> >;
-
 /**
- * scan a part of input
- * .    .    .    .    .    .    .    .    .    .    .    .    .
- * Kansas;12.3\München;2.1\Hamburg;13.4\Blabla;34.4\Kairo;17.4\
- * *########################
- *                     ####*####################
- *                                    ##*######################
- * @param input input file
- * @param start offset in file from where to start; actually start _after_ the first new-line behind start, except if start == 0
- * @param end pffset in file where to stop; actually continue until the first new-line behind end
- * @return the map off aggregated values
+ * With incremental the snapshot is loaded and only the tail behind it is
+ * processed, if the file still starts with the bytes the snapshot was taken
+ * from. Otherwise, the whole file is processed.
  */
-auto scan_input(mmapped_file const & input, size_t start, size_t end, size_t partition, bool verbose) -> agg_map_type {
-    using std::string_view_literals::operator ""sv;
-    agg_map_type map(1000);
-    static constexpr size_t MAX_FIELDS_CNT = 10;
-    std::vector<size_t> field_pos(MAX_FIELDS_CNT);
-    size_t file_pos = start;
-    size_t skipped = 0;
-    while (file_pos < end) {
-        if (start > 0 && file_pos == start)
-            file_pos--;;
-        auto chunk = input.get_chunk_for_offset(file_pos);
-        auto sv = chunk.string_view().substr(chunk.initial_offset_);
-        size_t i = 0;
-        if (start > 0 && file_pos == start - 1) {
-            // search for first new-line
-            auto nl = sv.find(u8'\n');
-            if (nl != std::string_view::npos) {
-                skipped = nl + 1;
-                i += skipped;
-                if (verbose)
-                    fmt::println(stderr, "Partition {:02} skipped {} bytes.", partition, i);
-            } else {
-                std::cerr << "Cannot find start of chunk" << (chunk.chunk_start_ + chunk.initial_offset_) << '\n';
-                throw std::runtime_error("Cannot find start of chunk");
-            }
-        }
-        field_pos.clear();
-        field_pos.push_back(i);
-        for (; i < sv.size(); ++i) {
-            if (sv[i] != u8';' && sv[i] != u8'\n')
-                continue;
-            field_pos.push_back(i + 1);
-            if (sv[i] == u8';') {
-                if (field_pos.size() >= MAX_FIELDS_CNT) {
-                    fmt::println(stderr, "Broken format in input file: too many fields at offset {}", (chunk.chunk_start_ + chunk.initial_offset_ + i));
-                    throw std::runtime_error("Broken format in input file: too many fields");
-                }
+auto plan_snapshot_run(std::string const & file_name, std::string const & snapshot_file, size_t columns, bool incremental,
+                       bool verbose) -> snapshot_plan {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror(file_name.c_str());
+        exit(ERROR_OTHER);
+    }
+    snapshot_plan plan;
+    try {
+        plan.size_ = std::filesystem::file_size(file_name);
+        plan.end_ = snapshot::end_of_lines(fd, plan.size_);
+        plan.fingerprint_ = snapshot::fingerprint(fd, plan.end_);
+        if (incremental) {
+            try {
+                plan.previous_ = snapshot::read(snapshot_file);
+            } catch (std::runtime_error& e) {
+                fmt::println(stderr, "{}: {}; processing the whole file.", snapshot_file, e.what());
             }
-            if (sv[i] == u8'\n') {
-                if (field_pos.size() != 3) {
-                    fmt::println(stderr, "Broken format in input file: too many fields at offset {}", (chunk.chunk_start_ + chunk.initial_offset_ + i));
-                    throw std::runtime_error("Broken format in input file: not 2 fields");
-                }
-                auto station_view = sv.substr(field_pos[0], field_pos[1] - 1 - field_pos[0]);
-                auto value_view = sv.substr(field_pos[1], field_pos[2] - 1 - field_pos[1]);
-#ifdef USE_SIMPLE_PARSE_FLOAT
-                auto parse_result = super_simple_parse_float(value_view);
-                if (!parse_result) {
-                    fmt::println(stderr, "Broken format in input file: cannot parse float value {} at offset {}", value_view, (chunk.chunk_start_ + chunk.initial_offset_ + i));
-                    throw std::runtime_error("Broken float value in input file.");
-                }
-                float float_value = parse_result.value();
-#else
-                float float_value = std::stof(std::string(value_view));
-#endif
-                auto found = map.find(station_view);
-                if (found == map.end()) {
-                    map.emplace(station_view, float_value);
+            if (plan.previous_) {
+                auto const offset = plan.previous_->offset_;
+                if (plan.previous_->columns_ != columns) {
+                    fmt::println(stderr, "Snapshot {} has {} value columns instead of {}; processing the whole file.",
+                                 snapshot_file, plan.previous_->columns_, columns);
+                    plan.previous_.reset();
+                } else if (offset <= plan.end_ && snapshot::fingerprint(fd, offset) == plan.previous_->fingerprint_) {
+                    plan.begin_ = offset;
+                    if (verbose)
+                        fmt::println(stderr, "Continuing snapshot {} of {} bytes with {} stations.",
+                                     snapshot_file, offset, plan.previous_->stations_.size());
                 } else {
-                    found->second.add_value(float_value);
+                    fmt::println(stderr, "Snapshot {} does not match {}; processing the whole file.", snapshot_file, file_name);
+                    plan.previous_.reset();
                 }
-                ++i;
-                field_pos.clear();
-                field_pos.push_back(i);
-                file_pos = chunk.chunk_start_ + chunk.initial_offset_ + i;
-                if (file_pos >= end)
-                    break;
+            } else if (verbose) {
+                fmt::println(stderr, "No snapshot {}; processing the whole file.", snapshot_file);
             }
         }
-
+    } catch (std::runtime_error& e) {
+        fmt::println(stderr, "{}: {}", file_name, e.what());
+        close(fd);
+        exit(ERROR_OTHER);
     }
-    if (verbose)
-        fmt::println(stderr, "Partition {:02d} processed from {:12L} to actually {:12L} (end: {:12L})",
-        partition, start + skipped,file_pos, end);
-    return map;
+    close(fd);
+    return plan;
 }
 
-// Benutzerdefinierter Vergleichsoperator für UTF-8-codierte Strings
-struct UTF8StringComparator {
-    bool operator()(const std::string& str1, const std::string& str2) const {
-        // Verwende locale, um die UTF-8-codierten Strings zu vergleichen
-        std::locale loc("");
+/**
+ * save the statistics of the complete lines of the plan for the next run
+ */
+void write_snapshot(std::string const & snapshot_file, snapshot_plan const & plan, size_t columns, aggregator const & result) {
+    try {
+        snapshot::write(snapshot_file, plan.end_, plan.fingerprint_, columns, result.shards());
+    } catch (std::runtime_error& e) {
+        fmt::println(stderr, "{}: {}", snapshot_file, e.what());
+        exit(ERROR_OTHER);
+    }
+}
 
-        // Verwende std::use_facet, um das std::collate-Facet zu erhalten
-        const std::collate<char>& coll = std::use_facet<std::collate<char>>(loc);
+/**
+ * @return the names of a list like "temp,humidity" or an empty optional if a name is empty or repeated
+ */
+auto parse_column_names(std::string_view list) -> std::optional<std::vector<std::string>> {
+    std::vector<std::string> names;
+    for (;;) {
+        auto const comma = list.find(',');
+        std::string name(list.substr(0, comma));
+        if (name.empty() || std::find(names.begin(), names.end(), name) != names.end())
+            return {};
+        names.push_back(std::move(name));
+        if (comma == std::string_view::npos)
+            return names;
+        list.remove_prefix(comma + 1);
+    }
+}
 
-        // Vergleiche die Strings mit coll.compare
-        return coll.compare(str1.data(), str1.data() + str1.length(),
-            str2.data(), str2.data() + str2.length()) < 0;
+/**
+ * @return the predicates of a list like "temp>30,humidity<=80" or an empty optional if one of them is invalid
+ */
+auto parse_predicates(std::string_view list, std::vector<std::string> const & columns) -> std::optional<std::vector<predicate>> {
+    std::vector<predicate> predicates;
+    for (;;) {
+        auto const comma = list.find(',');
+        auto const p = parse_predicate(list.substr(0, comma), columns);
+        if (!p)
+            return {};
+        predicates.push_back(*p);
+        if (comma == std::string_view::npos)
+            return predicates;
+        list.remove_prefix(comma + 1);
     }
-};
+}
 
-static constexpr int ERROR_ARGS = 1;
-static constexpr int ERROR_FILE_FORMAT = 2;
-static constexpr int ERROR_OTHER = 3;
+/**
+ * @return the station names in file_name, one per line, or an empty optional if it cannot be read
+ */
+auto read_station_names(std::string const & file_name) -> std::optional<std::vector<std::string>> {
+    std::ifstream in(file_name);
+    if (!in)
+        return {};
+    std::vector<std::string> names;
+    for (std::string line; std::getline(in, line);) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty())
+            names.push_back(std::move(line));
+    }
+    if (in.bad())
+        return {};
+    return names;
+}
 
 int main(int argc, char *argv[]) {
     int ret = 0;
     argparse::ArgumentParser args("1brc", "1.0");
     args.add_argument("-T", "--threads").metavar(("THREADS")).help("Use specified number of threads").scan<'i', size_t>();
-    args.add_argument("file").help("input CSV file with two columns: STATION;DEGREES").required();
+    args.add_argument("file").help("input CSV file with the columns STATION;DEGREES (see --columns and --group-by); - or a pipe is read as a stream; zstd or gzip compressed input is decompressed").required();
+    args.add_argument("-R", "--range-size").metavar("BYTES").help("Size of the ranges of the file claimed by the threads one after another").scan<'i', size_t>();
+    args.add_argument("-I", "--io").metavar("BACKEND").help("How to read the file: mmap or pread").default_value(std::string("mmap"));
+    args.add_argument("-M", "--mapping").metavar("MODE").help("How to map the file: chunked, whole or auto (whole if the file fits into the available memory)").default_value(std::string("auto"));
+    args.add_argument("--populate").help("prefault all pages of a whole file mapping").default_value(false).implicit_value(true);
+    args.add_argument("--huge-pages").help("align a whole file mapping to huge pages").default_value(false).implicit_value(true);
+    args.add_argument("--direct").help("bypass the page cache (O_DIRECT) when reading with pread").default_value(false).implicit_value(true);
+    args.add_argument("--pin").help("pin the threads to CPUs spread over the NUMA nodes; the file ranges and the merge are kept within the nodes").default_value(false).implicit_value(true);
+    args.add_argument("-C", "--columns").metavar("NAMES").help("Names of the value columns, e.g. temp,humidity,pressure for lines STATION;TEMP;HUMIDITY;PRESSURE").default_value(std::string("temp"));
+    args.add_argument("-P", "--parser").metavar("PARSER").help("How to parse the values: tenths (strictly -?[0-9]{1,2}.[0-9] like the challenge) or decimal (any decimal number)").default_value(std::string(default_value_parser == value_parser::tenths ? "tenths" : "decimal"));
+    args.add_argument("-D", "--distribution").help("keep the distribution of the (first) values per station: adds standard deviation, p50, p95 and p99 to the table, csv and json output; about 2KB per station and thread").default_value(false).implicit_value(true);
+    args.add_argument("-G", "--group-by").metavar("BUCKET").help("aggregate per station and hour or day of a timestamp in front of every line: TIMESTAMP;STATION;DEGREES with ISO-8601 (2024-05-01T13:45:00Z, optionally with fractions or an offset) or epoch seconds");
+    args.add_argument("--stations").metavar("FILE").help("only aggregate the stations listed in FILE, one name per line");
+    args.add_argument("-W", "--where").metavar("PREDICATES").help("only aggregate the lines whose values satisfy all of the comma separated predicates, e.g. temp>30 or temp>=-10,temp<0 (<, <=, >, >=, =)");
+    args.add_argument("--sort").metavar("ORDER").help("Order of the stations: locale (collation of LANG/LC_COLLATE) or bytes").default_value(std::string("locale"));
+    args.add_argument("-F", "--format").metavar("FORMAT").help("Output format: table, official ({name=min/mean/max, ...}), csv, json, binary or histogram (station,value,count)").default_value(std::string("table"));
+    args.add_argument("--snapshot").metavar("FILE").help("save the aggregated statistics to FILE after the run");
+    args.add_argument("--incremental").help("continue the --snapshot of a previous run: only process what was appended to the file since").default_value(false).implicit_value(true);
+    args.add_argument("-S", "--stats").help("print time per phase, throughput, page faults and hardware counters of all threads").default_value(false).implicit_value(true);
     args.add_argument("-V", "--verbose").help("print verbose output").default_value(false).implicit_value(true);
     try {
         args.parse_args(argc, argv);
@@ -180,76 +192,162 @@ int main(int argc, char *argv[]) {
     }
     std::string file_name = args.get("file");
     bool const verbose = args.get<bool>("-V");
-    mmapped_file input(file_name);
-    if (input) {
-
-        agg_map_type aggregated_result(1000);
-        std::vector<std::jthread> threads;
-        std::vector<std::future<void>> futures;
-        std::mutex mtx;
-
-        size_t max_chunks = (size_t)std::ceil(static_cast<double>(input.file_size()) / (double)input.chunk_size());
-        size_t max_threads = args.present<size_t>("-T").value_or(std::thread::hardware_concurrency());
-        auto partitions = std::min(max_chunks, max_threads);
-        auto partition_size = (double)input.file_size() / (double)partitions;
-        if (verbose){
-            fmt::println(stderr, "Using chunk size of {}.", input.chunk_size());
-            fmt::println(stderr, "File has size {}.", input.file_size());
-            fmt::println(stderr, "Maximum of {} chunks.", max_chunks);
-            fmt::println(stderr, "Using {} partitions (threads).", partitions);
+    aggregator_options options;
+    options.threads_ = args.present<size_t>("-T").value_or(std::thread::hardware_concurrency());
+    options.range_size_ = args.present<size_t>("-R");
+    options.verbose_ = verbose;
+    options.direct_ = args.get<bool>("--direct");
+    options.pin_threads_ = args.get<bool>("--pin");
+    if (auto io = parse_io_backend(args.get("--io"))) {
+        options.io_ = *io;
+    } else {
+        fmt::println(stderr, "Unknown io backend {}", args.get("--io"));
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    if (auto strategy = parse_mapping_strategy(args.get("--mapping"))) {
+        options.mapping_.strategy_ = *strategy;
+    } else {
+        fmt::println(stderr, "Unknown mapping mode {}", args.get("--mapping"));
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    if (auto parser = parse_value_parser(args.get("--parser"))) {
+        options.scan_.parser_ = *parser;
+    } else {
+        fmt::println(stderr, "Unknown value parser {}", args.get("--parser"));
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    auto const columns = parse_column_names(args.get("--columns"));
+    if (!columns || columns->size() > scan_options::MAX_COLUMNS) {
+        fmt::println(stderr, "Invalid value columns {}; up to {} distinct names are supported", args.get("--columns"), scan_options::MAX_COLUMNS);
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    options.scan_.columns_ = columns->size();
+    auto const order = parse_sort_order(args.get("--sort"));
+    if (!order) {
+        fmt::println(stderr, "Unknown sort order {}", args.get("--sort"));
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    auto const format = parse_output_format(args.get("--format"));
+    if (!format) {
+        fmt::println(stderr, "Unknown output format {}", args.get("--format"));
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    options.scan_.distribution_ = args.get<bool>("--distribution") || *format == output_format::histogram;
+    if (auto const group_by = args.present("--group-by")) {
+        options.scan_.group_by_ = parse_time_bucket(*group_by);
+        if (!options.scan_.group_by_) {
+            fmt::println(stderr, "Unknown time bucket {}", *group_by);
+            std::cerr << args;
+            exit(ERROR_ARGS);
         }
-
-        for(size_t partition_nr = 0; partition_nr < partitions; ++partition_nr) {
-            size_t start = (size_t)((double)partition_nr * partition_size);
-            size_t end = (size_t)(((double)partition_nr + 1) * partition_size);
-            std::promise<void> prm;
-            futures.push_back(prm.get_future());
-            threads.emplace_back([&input, &aggregated_result, &mtx, promise=std::move(prm), partition_nr, start, end, verbose] () mutable {
-                if (verbose)
-                    fmt::println(stderr, "Partition {:02} from {:9L} to {:9L}", partition_nr, start, end);
-                try {
-                    auto local_result = scan_input(input, start, end, partition_nr, verbose);
-                    {
-                        std::lock_guard<std::mutex> lock(mtx);
-                        for (auto const & [key, value] : local_result) {
-                            auto found = aggregated_result.find(key);
-                            if (found == aggregated_result.end()) {
-                                aggregated_result.emplace(key, value);
-                            } else {
-                                found->second.combine(value);
-                            }
-                        }
-                    }
-                    promise.set_value();
-                } catch (std::runtime_error& e) {
-                    fmt::println("Exception in partition {}: {}", partition_nr, e.what());
-                    promise.set_exception(std::current_exception());
-                }
-            });
+    }
+    auto const snapshot_file = args.present("--snapshot");
+    bool const incremental = args.get<bool>("--incremental");
+    if (snapshot_file && options.scan_.distribution_) {
+        fmt::println(stderr, "--snapshot does not keep distributions");
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    if (snapshot_file && options.scan_.group_by_) {
+        fmt::println(stderr, "--snapshot does not support --group-by");
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    auto const stations_file = args.present("--stations");
+    auto const where = args.present("--where");
+    if (stations_file || where) {
+        if (snapshot_file) {
+            fmt::println(stderr, "--snapshot does not support --stations and --where");
+            std::cerr << args;
+            exit(ERROR_ARGS);
         }
-        for(auto & e : futures) {
-            try {
-                e.get();
-            } catch (std::runtime_error& e) {
-                ret = ERROR_FILE_FORMAT;
-            } catch (std::exception& e) {
-                ret = ERROR_OTHER;
+        auto filter = std::make_shared<line_filter>();
+        if (stations_file) {
+            auto const names = read_station_names(*stations_file);
+            if (!names) {
+                fmt::println(stderr, "Cannot read the stations of {}", *stations_file);
+                exit(ERROR_OTHER);
+            }
+            filter->allow_stations(*names);
+        }
+        if (where) {
+            auto const predicates = parse_predicates(*where, *columns);
+            if (!predicates) {
+                fmt::println(stderr, "Invalid predicates {}; expected column names (see --columns) compared to numbers like temp>30", *where);
+                std::cerr << args;
+                exit(ERROR_ARGS);
             }
+            for (auto const & p : *predicates)
+                filter->add_predicate(p);
         }
-        if (ret != 0)
-            exit(ret);
+        options.scan_.filter_ = std::move(filter);
+    }
+    if (incremental && !snapshot_file) {
+        fmt::println(stderr, "--incremental requires --snapshot");
+        std::cerr << args;
+        exit(ERROR_ARGS);
+    }
+    options.mapping_.populate_ = args.get<bool>("--populate");
+    options.mapping_.huge_pages_ = args.get<bool>("--huge-pages");
+    run_stats stats;
+    if (args.get<bool>("--stats"))
+        options.stats_ = &stats;
 
-        // convert to a sorted map
-        std::map<std::string, statistics, UTF8StringComparator> sorted_map(aggregated_result.begin(), aggregated_result.end());
-        // print all collected statistics
-        fmt::println(" **** Statistics ***");
-        size_t cnt = 0;
-        for (auto const &e: sorted_map) {
-            fmt::println("{:<30} {:5.1f}|{:5.1f}|{:5.1f}|{:6d}", e.first,
-                e.second.min_, e.second.avg(), e.second.max_, e.second.cnt_);
-            cnt += e.second.cnt_;
+    bool const regular_file = file_name != "-" && std::filesystem::is_regular_file(file_name);
+    if (snapshot_file && (!regular_file || file_compression(file_name) != compression::none)) {
+        fmt::println(stderr, "--snapshot requires an uncompressed regular file");
+        exit(ERROR_ARGS);
+    }
+    std::optional<snapshot_plan> plan;
+    if (snapshot_file)
+        plan = plan_snapshot_run(file_name, *snapshot_file, columns->size(), incremental, verbose);
+
+    aggregator result(options);
+    try {
+        if (plan) {
+            // only the part given by the plan, combined with the previous snapshot
+            result.add_file(file_name, plan->begin_, plan->end_);
+            if (plan->previous_)
+                result.merge(plan->previous_->stations_);
+            write_snapshot(*snapshot_file, *plan, columns->size(), result);
+            // like in a run without snapshot the output includes a last line without new-line
+            if (plan->end_ < plan->size_)
+                result.add_file(file_name, plan->end_, plan->size_);
+        } else {
+            result.add_file(file_name);
         }
-        fmt::println(stderr, "\nCounted {} total measures.", cnt);
+    } catch (format_error& e) {
+        fmt::println(stderr, "{}: {}", file_name, e.what());
+        exit(ERROR_FILE_FORMAT);
+    } catch (std::exception& e) {
+        fmt::println(stderr, "{}: {}", file_name, e.what());
+        exit(ERROR_OTHER);
+    }
+
+    // sort by station name
+    auto const sort_start = stats_clock::now();
+    auto const sorted = result.results(*order);
+    stats.sort_s_ = seconds_since(sort_start);
+    // print all collected statistics with a single write
+    auto const output_start = stats_clock::now();
+    result_formatter formatter(*format, *columns, options.scan_.distribution_, options.scan_.group_by_);
+    // a closed stdout (EPIPE) is reported like any other failed write instead of ending the process silently
+    std::signal(SIGPIPE, SIG_IGN);
+    try {
+        write_all(STDOUT_FILENO, formatter.format(sorted));
+    } catch (std::runtime_error& e) {
+        fmt::println(stderr, "stdout: {}", e.what());
+        exit(ERROR_OTHER);
     }
+    stats.output_s_ = seconds_since(output_start);
+    fmt::println(stderr, "\nCounted {} total measures.", result.measurement_count());
+    if (options.stats_)
+        stats.print(stderr);
     return ret;
 }
@@ -0,0 +1,41 @@
+#ifndef MEMORY_INPUT_H
+#define MEMORY_INPUT_H
+
+#include <cstddef>
+#include <limits>
+#include <string_view>
+
+/**
+ * Input for scan_input() from a buffer in memory, e.g. handed over by an
+ * application embedding the aggregator. It offers the interface of
+ * mmapped_file; a chunk is the whole rest of the buffer.
+ */
+class memory_input {
+public:
+    struct chunk {
+        [[nodiscard]] std::string_view string_view() const noexcept { return sv_; }
+
+        std::string_view sv_;
+        size_t chunk_start_;
+        size_t initial_offset_;
+    };
+
+    explicit memory_input(std::string_view data) noexcept : data_{data} {
+    }
+
+    [[nodiscard]] size_t file_size() const noexcept { return data_.size(); }
+
+    /** the size of the ranges is bounded by the chunk size; in memory there is no reason to */
+    [[nodiscard]] static size_t chunk_size() noexcept { return size_t{1} << 26; }
+
+    [[nodiscard]] auto chunk_reader() const -> memory_input const & { return *this; }
+
+    auto get_chunk_for_offset(size_t off, [[maybe_unused]] size_t until = std::numeric_limits<size_t>::max()) const -> chunk {
+        return chunk{data_.substr(off), off, 0};
+    }
+
+private:
+    std::string_view data_;
+};
+
+#endif //MEMORY_INPUT_H
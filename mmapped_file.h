@@ -5,18 +5,49 @@
 #ifndef MMAPPED_FILE_H
 #define MMAPPED_FILE_H
 
+#include <cstdint>
+#include <cstdio>
 #include <fcntl.h>
 #include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <utility>
 
+/**
+ * How the file is mapped into memory:
+ * - chunked: every chunk is mapped and unmapped on its own; needs the least memory
+ * - whole_file: the file is mapped once, chunks are views into this mapping
+ * - automatic: whole_file if the file fits into the available memory, chunked otherwise
+ */
+enum class mapping_strategy { chunked, whole_file, automatic };
+
+inline auto parse_mapping_strategy(std::string_view name) -> std::optional<mapping_strategy> {
+    if (name == "chunked")
+        return mapping_strategy::chunked;
+    if (name == "whole")
+        return mapping_strategy::whole_file;
+    if (name == "auto")
+        return mapping_strategy::automatic;
+    return {};
+}
+
+struct mapping_options {
+    mapping_strategy strategy_{mapping_strategy::automatic};
+    bool populate_{false};   // whole_file only: prefault all pages (MAP_POPULATE)
+    bool huge_pages_{false}; // whole_file only: align the mapping to 2 MiB and ask for huge pages
+};
+
 class mmapped_file {
 public:
     struct mmemory_chunk {
-        mmemory_chunk(void *ptr, size_t len, size_t chunk_start, size_t initial_offset)
-            : ptr_{ptr}, len_{len}, chunk_start_(chunk_start), initial_offset_(initial_offset) {
+        mmemory_chunk(void *ptr, size_t len, size_t chunk_start, size_t initial_offset, bool owning = true)
+            : ptr_{ptr}, len_{len}, chunk_start_(chunk_start), initial_offset_(initial_offset), owning_{owning} {
         }
 
         mmemory_chunk(mmemory_chunk const &) = delete;
@@ -29,6 +60,7 @@ public:
             std::swap(len_, other.len_);
             std::swap(initial_offset_, other.initial_offset_);
             std::swap(chunk_start_, other.chunk_start_);
+            std::swap(owning_, other.owning_);
             other.ptr_ = nullptr;
             other.initial_offset_ = 0;
             other.len_ = 0;
@@ -37,7 +69,7 @@ public:
         };
 
         mmemory_chunk(mmemory_chunk &&other) noexcept
-            : ptr_{other.ptr_}, len_{other.len_}, chunk_start_(other.chunk_start_), initial_offset_(other.initial_offset_) {
+            : ptr_{other.ptr_}, len_{other.len_}, chunk_start_(other.chunk_start_), initial_offset_(other.initial_offset_), owning_{other.owning_} {
             other.ptr_ = nullptr;
             other.len_ = 0;
             other.chunk_start_ = 0;
@@ -45,7 +77,7 @@ public:
         }
 
         ~mmemory_chunk() noexcept {
-            if (ptr_ != nullptr)
+            if (ptr_ != nullptr && owning_)
                 munmap(ptr_, len_);
             len_ = 0;
             ptr_ = nullptr;
@@ -60,6 +92,7 @@ public:
         size_t len_{0};
         size_t chunk_start_ {0};
         size_t initial_offset_{0};
+        bool owning_{true}; // false for views into a whole file mapping
     };
 
     static size_t page_size() {
@@ -67,7 +100,25 @@ public:
         return ps;
     }
 
-    explicit mmapped_file(std::string const &file_name, size_t chunk_size_approx = 1 << 26) // 1 << 26
+    static constexpr size_t HUGE_PAGE_SIZE = 1 << 21;
+
+    /**
+     * @return MemAvailable from /proc/meminfo or the number of free pages if that is not available
+     */
+    static size_t available_memory() {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string key;
+        size_t kb;
+        while (meminfo >> key >> kb) {
+            if (key == "MemAvailable:")
+                return kb * 1024;
+            meminfo.ignore(64, '\n');
+        }
+        return static_cast<size_t>(sysconf(_SC_AVPHYS_PAGES)) * page_size();
+    }
+
+    explicit mmapped_file(std::string const &file_name, size_t chunk_size_approx = 1 << 26, // 1 << 26
+                          mapping_options const &options = {})
         : file_name_{file_name} {
         file_size_ = std::filesystem::file_size(file_name_);
         fd_ = open(file_name_.c_str(), O_RDONLY);
@@ -75,12 +126,28 @@ public:
             perror((file_name_.c_str()));
         }
         compute_chunks(chunk_size_approx);
+        strategy_ = options.strategy_;
+        if (strategy_ == mapping_strategy::automatic)
+            strategy_ = file_size_ <= available_memory() ? mapping_strategy::whole_file : mapping_strategy::chunked;
+        if (fd_ > 0 && strategy_ == mapping_strategy::whole_file && file_size_ > 0)
+            map_whole_file(options);
     }
 
+    mmapped_file(mmapped_file const &) = delete;
+    mmapped_file &operator=(mmapped_file const &) = delete;
+
     ~mmapped_file() noexcept {
+        if (whole_ != nullptr)
+            munmap(whole_, file_size_);
         close(fd_);
     }
 
+    [[nodiscard]] mapping_strategy strategy() const noexcept { return strategy_; }
+
+    [[nodiscard]] char const * strategy_name() const noexcept {
+        return strategy_ == mapping_strategy::whole_file ? "whole file" : "chunked";
+    }
+
     uintmax_t file_size() const noexcept { return file_size_; }
 
     operator bool() const noexcept { return fd_ > 0; }
@@ -103,7 +170,16 @@ public:
     }
     */
 
-    auto get_chunk_for_offset(size_t off) const -> mmemory_chunk {
+    /**
+     * mmapped_file is stateless, so every thread can use it directly
+     */
+    [[nodiscard]] auto chunk_reader() const -> mmapped_file const & { return *this; }
+
+    /**
+     * @param off file offset of the first byte needed
+     * @param until unused; part of the common interface with pread_file::reader
+     */
+    auto get_chunk_for_offset(size_t off, [[maybe_unused]] size_t until = std::numeric_limits<size_t>::max()) const -> mmemory_chunk {
         //std::cerr << __func__ << "(" << off << ")\n";
         auto find_closest_multiple = [](auto n, auto v) {
             auto result = ((n + v - 1) / v) * v;
@@ -115,6 +191,8 @@ public:
         size_t chunk_start = find_closest_multiple(off, page_size());
         size_t initial_offset = off - chunk_start;
         size_t len = std::min(chunk_size_, file_size_ - chunk_start);
+        if (whole_ != nullptr)
+            return mmemory_chunk{static_cast<char *>(whole_) + chunk_start, len, chunk_start, initial_offset, false};
         void *ptr = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd_, static_cast<long>(chunk_start));
         if (MAP_FAILED == ptr) {
             perror(file_name_.c_str());
@@ -123,7 +201,68 @@ public:
         return mmemory_chunk{ptr, len, chunk_start, initial_offset};
     }
 
+    /**
+     * @return the whole file in one piece, also with the chunked strategy; unlike get_chunk_for_offset(0)
+     * not limited to chunk_size()
+     */
+    auto get_whole_file() const -> mmemory_chunk {
+        if (whole_ != nullptr)
+            return mmemory_chunk{whole_, file_size_, 0, 0, false};
+        if (file_size_ == 0)
+            return mmemory_chunk{nullptr, 0, 0, 0};
+        void *ptr = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (MAP_FAILED == ptr) {
+            perror(file_name_.c_str());
+            throw std::runtime_error("MAP FAILED");
+        }
+        return mmemory_chunk{ptr, file_size_, 0, 0};
+    }
+
 protected:
+    void map_whole_file(mapping_options const &options) {
+        int flags = MAP_SHARED;
+        if (options.populate_)
+            flags |= MAP_POPULATE;
+        void *addr = nullptr;
+        void *reserved = MAP_FAILED;
+        size_t const reserved_len = file_size_ + HUGE_PAGE_SIZE;
+        if (options.huge_pages_) {
+            // reserve enough address space to place the file at a huge page boundary
+            reserved = mmap(nullptr, reserved_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (reserved != MAP_FAILED) {
+                auto const aligned = (reinterpret_cast<uintptr_t>(reserved) + HUGE_PAGE_SIZE - 1) & ~(uintptr_t{HUGE_PAGE_SIZE} - 1);
+                addr = reinterpret_cast<void *>(aligned);
+                flags |= MAP_FIXED;
+            }
+        }
+        void *ptr = mmap(addr, file_size_, PROT_READ, flags, fd_, 0);
+        if (reserved != MAP_FAILED) {
+            // release the unused head and tail of the reservation
+            auto const head = static_cast<size_t>(static_cast<char *>(addr) - static_cast<char *>(reserved));
+            auto const mapped_end = (file_size_ + page_size() - 1) / page_size() * page_size();
+            if (ptr == MAP_FAILED) {
+                munmap(reserved, reserved_len);
+            } else {
+                if (head > 0)
+                    munmap(reserved, head);
+                if (head + mapped_end < reserved_len)
+                    munmap(static_cast<char *>(addr) + mapped_end, reserved_len - head - mapped_end);
+            }
+        }
+        if (MAP_FAILED == ptr) {
+            // not fatal, fall back to mapping chunk by chunk
+            perror(file_name_.c_str());
+            strategy_ = mapping_strategy::chunked;
+            return;
+        }
+        whole_ = ptr;
+        madvise(whole_, file_size_, MADV_SEQUENTIAL);
+        if (!options.populate_)
+            madvise(whole_, file_size_, MADV_WILLNEED);
+        if (options.huge_pages_)
+            madvise(whole_, file_size_, MADV_HUGEPAGE);
+    }
+
     void compute_chunks(size_t chunk_size_approx) noexcept {
         auto find_closest_multiple = [](auto n, auto v) {
             size_t result = ((n + v - 1) / v) * v;
@@ -147,6 +286,8 @@ private:
     size_t chunks_total_;
     size_t chunks_last_remainder_;
     size_t chunk_size_;
+    mapping_strategy strategy_{mapping_strategy::chunked};
+    void *whole_{nullptr}; // mapping of the whole file, if any
 };
 
 #endif //MMAPPED_FILE_H
@@ -0,0 +1,148 @@
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * The NUMA nodes of the machine and the CPUs of each node this process may
+ * run on, read from sysfs (no libnuma needed). Machines without NUMA
+ * information and nodes without usable CPUs are treated as a single node.
+ */
+class numa_topology {
+public:
+    struct node {
+        int id_;
+        std::vector<int> cpus_;
+    };
+
+    /**
+     * @param sysfs_root directory with the node<N>/cpulist files
+     */
+    static auto detect(std::filesystem::path const & sysfs_root = "/sys/devices/system/node") -> numa_topology {
+        auto const allowed = allowed_cpus();
+        numa_topology result;
+        std::error_code ec;
+        for (auto const & entry : std::filesystem::directory_iterator(sysfs_root, ec)) {
+            auto const name = entry.path().filename().string();
+            int id;
+            if (!name.starts_with("node") || std::from_chars(name.data() + 4, name.data() + name.size(), id).ec != std::errc{})
+                continue;
+            std::ifstream in(entry.path() / "cpulist");
+            std::string list;
+            std::getline(in, list);
+            auto cpus = parse_cpu_list(list).value_or(std::vector<int>{});
+            std::erase_if(cpus, [&allowed](int cpu) { return !std::binary_search(allowed.begin(), allowed.end(), cpu); });
+            if (!cpus.empty())
+                result.nodes_.push_back(node{id, std::move(cpus)});
+        }
+        std::sort(result.nodes_.begin(), result.nodes_.end(), [](auto const & a, auto const & b) { return a.id_ < b.id_; });
+        if (result.nodes_.empty())
+            result.nodes_.push_back(node{0, allowed});
+        return result;
+    }
+
+    /**
+     * @return the CPUs of a list like "0-3,8,10-11" or an empty optional if it is malformed
+     */
+    static auto parse_cpu_list(std::string_view list) -> std::optional<std::vector<int>> {
+        std::vector<int> cpus;
+        while (!list.empty() && (list.back() == '\n' || list.back() == ' '))
+            list.remove_suffix(1);
+        while (!list.empty()) {
+            auto const comma = list.find(',');
+            auto const item = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+            int first;
+            int last;
+            auto [ptr, ec] = std::from_chars(item.data(), item.data() + item.size(), first);
+            if (ec != std::errc{})
+                return {};
+            last = first;
+            if (ptr != item.data() + item.size()) {
+                if (*ptr != '-')
+                    return {};
+                auto const range_end = std::from_chars(ptr + 1, item.data() + item.size(), last);
+                if (range_end.ec != std::errc{} || range_end.ptr != item.data() + item.size())
+                    return {};
+            }
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    [[nodiscard]] auto nodes() const noexcept -> std::vector<node> const & { return nodes_; }
+
+    /**
+     * bind the calling thread to cpu
+     * @return false if that is not possible
+     */
+    static bool pin_current_thread(int cpu) noexcept {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+private:
+    /** the sorted CPUs this process may run on */
+    static auto allowed_cpus() -> std::vector<int> {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                if (CPU_ISSET(cpu, &set))
+                    cpus.push_back(cpu);
+        }
+        if (cpus.empty())
+            cpus.push_back(0);
+        return cpus;
+    }
+
+    std::vector<node> nodes_;
+};
+
+/**
+ * Where the worker threads run: threads are spread over the nodes in
+ * contiguous groups, within a node over its CPUs.
+ */
+struct thread_placement {
+    std::vector<size_t> node_of_thread_; // index into the nodes of the topology
+    std::vector<int> cpu_of_thread_;
+    size_t nodes_{1};
+
+    thread_placement() = default;
+
+    thread_placement(numa_topology const & topology, size_t threads)
+        : node_of_thread_(threads), cpu_of_thread_(threads), nodes_{std::min(topology.nodes().size(), std::max<size_t>(1, threads))} {
+        for (size_t t = 0; t < threads; ++t) {
+            size_t const node = t * nodes_ / threads;
+            size_t const first = (node * threads + nodes_ - 1) / nodes_; // first thread of the node
+            auto const & cpus = topology.nodes()[node].cpus_;
+            node_of_thread_[t] = node;
+            cpu_of_thread_[t] = cpus[(t - first) % cpus.size()];
+        }
+    }
+
+    /** @return the threads of node in ascending order */
+    [[nodiscard]] auto threads_of(size_t node) const -> std::vector<size_t> {
+        std::vector<size_t> result;
+        for (size_t t = 0; t < node_of_thread_.size(); ++t)
+            if (node_of_thread_[t] == node)
+                result.push_back(t);
+        return result;
+    }
+};
+
+#endif //NUMA_TOPOLOGY_H
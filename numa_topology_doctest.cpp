@@ -0,0 +1,57 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "numa_topology.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check parse_cpu_list") {
+    CHECK(numa_topology::parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(numa_topology::parse_cpu_list("") == std::vector<int>{});
+    CHECK(!numa_topology::parse_cpu_list("0-").has_value());
+    CHECK(!numa_topology::parse_cpu_list("a").has_value());
+}
+
+TEST_CASE("Check numa_topology::detect") {
+    auto const root = std::filesystem::temp_directory_path() / ("numa_doctest." + std::to_string(getpid()));
+    std::filesystem::create_directories(root / "node1");
+    std::filesystem::create_directories(root / "node0");
+    std::filesystem::create_directories(root / "power");
+    std::ofstream(root / "node0" / "cpulist") << "0-1023\n";
+    std::ofstream(root / "node1" / "cpulist") << "\n";
+    auto const topology = numa_topology::detect(root);
+    // node1 has no CPUs
+    REQUIRE(topology.nodes().size() == 1);
+    CHECK(topology.nodes()[0].id_ == 0);
+    CHECK(!topology.nodes()[0].cpus_.empty());
+    std::filesystem::remove_all(root);
+
+    auto const fallback = numa_topology::detect(root);
+    REQUIRE(fallback.nodes().size() == 1);
+    CHECK(fallback.nodes()[0].cpus_ == topology.nodes()[0].cpus_);
+}
+
+TEST_CASE("Check thread_placement") {
+    auto const root = std::filesystem::temp_directory_path() / ("numa_doctest." + std::to_string(getpid()));
+    // every node gets all allowed CPUs, so this works on any machine
+    for (auto node : {"node0", "node1"}) {
+        std::filesystem::create_directories(root / node);
+        std::ofstream(root / node / "cpulist") << "0-1023\n";
+    }
+    auto const topology = numa_topology::detect(root);
+    std::filesystem::remove_all(root);
+    REQUIRE(topology.nodes().size() == 2);
+
+    thread_placement placement(topology, 5);
+    CHECK(placement.nodes_ == 2);
+    CHECK(placement.node_of_thread_ == std::vector<size_t>{0, 0, 0, 1, 1});
+    CHECK(placement.threads_of(1) == std::vector<size_t>{3, 4});
+    auto const & cpus = topology.nodes()[1].cpus_;
+    CHECK(placement.cpu_of_thread_[3] == cpus[0]);
+    CHECK(placement.cpu_of_thread_[4] == cpus[1 % cpus.size()]);
+
+    thread_placement single(topology, 1);
+    CHECK(single.nodes_ == 1);
+    CHECK(single.node_of_thread_ == std::vector<size_t>{0});
+}
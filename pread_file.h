@@ -0,0 +1,203 @@
+#ifndef PREAD_FILE_H
+#define PREAD_FILE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+/**
+ * Reads a file with pread(2) into reusable buffers instead of mapping it.
+ *
+ * This avoids page faults while scanning, which stall threads unpredictably on
+ * network or cold storage. With O_DIRECT (if supported by the file system) the
+ * page cache is bypassed as well.
+ *
+ * The interface mirrors mmapped_file: every thread obtains its own reader via
+ * chunk_reader() and asks it for chunks starting at a file offset. A reader
+ * owns two buffers: while the caller scans one of them, the following part of
+ * the file is read into the other one in the background.
+ */
+class pread_file {
+public:
+    static constexpr size_t ALIGNMENT = 4096;  // offset, length and address alignment needed for O_DIRECT
+    static constexpr size_t HEADROOM = 1 << 16; // room to carry the unfinished line of one buffer into the next
+
+    /**
+     * a view into a buffer of a reader; valid until the next call of get_chunk_for_offset on that reader
+     */
+    struct chunk {
+        [[nodiscard]] std::string_view string_view() const { return {data_, len_}; }
+
+        char const *data_;
+        size_t len_;
+        size_t chunk_start_;    // file offset of data_[0]
+        size_t initial_offset_; // offset of the requested position within the chunk
+    };
+
+    class reader {
+    public:
+        explicit reader(pread_file const &file)
+            : file_{file}, buffers_{allocate(file.chunk_size_), allocate(file.chunk_size_)} {
+        }
+
+        // the background read refers to this object, so it must not move
+        reader(reader &&) = delete;
+
+        ~reader() {
+            if (prefetch_.valid())
+                prefetch_.wait();
+        }
+
+        /**
+         * @param off file offset of the first byte needed
+         * @param until the caller is going to read approximately up to this offset;
+         * used to limit the size of reads and to decide whether to read ahead
+         */
+        auto get_chunk_for_offset(size_t off, size_t until = std::numeric_limits<size_t>::max()) -> chunk {
+            auto &next = buffers_[1 - current_];
+            if (prefetch_.valid()) {
+                size_t const len = prefetch_.get();
+                auto const &cur = buffers_[current_];
+                // continue with the prefetched data if the rest of the current buffer fits in front of it
+                if (off >= cur.start_ && off <= next.start_ && next.start_ - off <= HEADROOM && off < next.start_ + len) {
+                    size_t const carry = next.start_ - off;
+                    std::memcpy(next.data() - carry, cur.data() + (off - cur.start_), carry);
+                    next.len_ = len;
+                    current_ = 1 - current_;
+                    read_ahead(until);
+                    auto const &b = buffers_[current_];
+                    return chunk{b.data() - carry, b.len_ + carry, off, 0};
+                }
+            }
+            auto &b = buffers_[current_];
+            b.start_ = off / ALIGNMENT * ALIGNMENT;
+            b.len_ = file_.read_block(b.data(), b.start_, read_size(b.start_, until));
+            read_ahead(until);
+            return chunk{b.data(), b.len_, b.start_, off - b.start_};
+        }
+
+    private:
+        struct free_deleter {
+            void operator()(char *p) const noexcept { std::free(p); }
+        };
+
+        struct buffer {
+            std::unique_ptr<char, free_deleter> mem_;
+            size_t start_{0}; // file offset of data()[0]
+            size_t len_{0};
+
+            [[nodiscard]] char *data() const noexcept { return mem_.get() + HEADROOM; }
+        };
+
+        static buffer allocate(size_t chunk_size) {
+            auto *p = static_cast<char *>(std::aligned_alloc(ALIGNMENT, HEADROOM + chunk_size));
+            if (p == nullptr)
+                throw std::bad_alloc();
+            return buffer{std::unique_ptr<char, free_deleter>(p)};
+        }
+
+        [[nodiscard]] size_t read_size(size_t start, size_t until) const noexcept {
+            // read a little more than needed to finish the last line
+            size_t const wanted = until == std::numeric_limits<size_t>::max() || until < start
+                ? file_.chunk_size_
+                : (until - start + HEADROOM + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            return std::min(wanted, file_.chunk_size_);
+        }
+
+        void read_ahead(size_t until) {
+            auto const &cur = buffers_[current_];
+            size_t const start = cur.start_ + cur.len_;
+            if (start >= file_.file_size_ || until == std::numeric_limits<size_t>::max() || start >= until + HEADROOM)
+                return;
+            auto &next = buffers_[1 - current_];
+            next.start_ = start;
+            size_t const len = read_size(start, until);
+            prefetch_ = std::async(std::launch::async, [this, &next, len]() {
+                return file_.read_block(next.data(), next.start_, len);
+            });
+        }
+
+        pread_file const &file_;
+        buffer buffers_[2];
+        size_t current_{0};
+        std::future<size_t> prefetch_;
+    };
+
+    explicit pread_file(std::string const &file_name, size_t chunk_size_approx = 1 << 23, bool direct = false)
+        : file_name_{file_name} {
+        file_size_ = std::filesystem::file_size(file_name_);
+        if (direct) {
+            fd_ = open(file_name_.c_str(), O_RDONLY | O_DIRECT);
+            direct_ = fd_ >= 0;
+        }
+        if (fd_ < 0)
+            fd_ = open(file_name_.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            perror((file_name_.c_str()));
+        } else if (!direct_) {
+            posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+        chunk_size_ = std::max(ALIGNMENT, (chunk_size_approx + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+    }
+
+    pread_file(pread_file const &) = delete;
+    pread_file &operator=(pread_file const &) = delete;
+
+    ~pread_file() noexcept {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    uintmax_t file_size() const noexcept { return file_size_; }
+
+    operator bool() const noexcept { return fd_ > 0; }
+
+    [[nodiscard]] size_t chunk_size() const noexcept { return chunk_size_; }
+
+    [[nodiscard]] bool direct() const noexcept { return direct_; }
+
+    [[nodiscard]] auto chunk_reader() const -> reader { return reader{*this}; }
+
+private:
+    /**
+     * read len bytes at offset off (both aligned) into buf
+     * @return number of bytes read; less than len only at the end of the file
+     */
+    size_t read_block(char *buf, size_t off, size_t len) const {
+        size_t done = 0;
+        while (done < len) {
+            auto const n = pread(fd_, buf + done, len - done, static_cast<off_t>(off + done));
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                perror(file_name_.c_str());
+                throw std::runtime_error("READ FAILED");
+            }
+            if (n == 0)
+                break;
+            done += static_cast<size_t>(n);
+            if (direct_ && done % ALIGNMENT != 0)
+                break; // a short read with O_DIRECT only happens at the end of the file
+        }
+        return std::min(done, file_size_ - std::min(off, file_size_));
+    }
+
+    std::string file_name_;
+    size_t file_size_{0}; // size of file in bytes
+    int fd_{-1};
+    bool direct_{false};
+    size_t chunk_size_;
+};
+
+#endif //PREAD_FILE_H
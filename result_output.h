@@ -0,0 +1,570 @@
+#ifndef RESULT_OUTPUT_H
+#define RESULT_OUTPUT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <locale>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "station_map.h"
+#include "statistics.h"
+#include "time_bucket.h"
+
+/**
+ * How stations are ordered in the output.
+ */
+enum class sort_order {
+    locale, // collation of the user's locale (LC_COLLATE / LANG)
+    bytes   // byte order of the UTF-8 names, i.e. code point order
+};
+
+inline auto parse_sort_order(std::string_view name) -> std::optional<sort_order> {
+    if (name == "locale")
+        return sort_order::locale;
+    if (name == "bytes")
+        return sort_order::bytes;
+    return {};
+}
+
+/**
+ * a station of the result; refers to the aggregated tables
+ */
+struct result_entry {
+    std::string_view name_;
+    station_statistics stats_;
+    int64_t bucket_start_{0}; // grouped results: seconds since the epoch at which the time bucket starts
+};
+
+/**
+ * Collect all stations of the shards into a flat vector and sort it.
+ *
+ * For the locale order every name is transformed once into its collation key
+ * (strxfrm), so that the sort only compares bytes instead of calling the
+ * collation for each comparison.
+ *
+ * If the stations were grouped by time buckets (see grouped_key), the keys
+ * are split into name and bucket, ordered by name and then by time.
+ */
+inline auto sorted_results(std::vector<station_map> const & shards, sort_order order,
+                           std::optional<time_bucket> group_by = {}) -> std::vector<result_entry> {
+    std::vector<result_entry> entries;
+    size_t total = 0;
+    for (auto const & shard : shards)
+        total += shard.size();
+    entries.reserve(total);
+    for (auto const & shard : shards) {
+        for (size_t n = 0; n < shard.size(); ++n) {
+            auto const key = shard.key(n);
+            if (group_by)
+                entries.push_back(result_entry{grouped_key::station(key), shard.at(n),
+                                               grouped_key::bucket(key) * bucket_seconds(*group_by)});
+            else
+                entries.push_back(result_entry{key, shard.at(n)});
+        }
+    }
+    auto const less = [](result_entry const & a, result_entry const & b) {
+        return a.name_ < b.name_ || (a.name_ == b.name_ && a.bucket_start_ < b.bucket_start_);
+    };
+    if (order == sort_order::bytes) {
+        std::sort(entries.begin(), entries.end(), less);
+        return entries;
+    }
+    std::locale const loc("");
+    auto const & coll = std::use_facet<std::collate<char>>(loc);
+    std::vector<std::pair<std::string, result_entry>> keyed;
+    keyed.reserve(entries.size());
+    for (auto const & e : entries)
+        keyed.emplace_back(coll.transform(e.name_.data(), e.name_.data() + e.name_.size()), e);
+    std::sort(keyed.begin(), keyed.end(), [&less](auto const & a, auto const & b) {
+        return a.first < b.first || (a.first == b.first && less(a.second, b.second));
+    });
+    for (size_t i = 0; i < keyed.size(); ++i)
+        entries[i] = keyed[i].second;
+    return entries;
+}
+
+/**
+ * How the results are printed.
+ */
+enum class output_format {
+    table,    // " **** Statistics ***" and padded columns
+    official, // {Abha=-23.0/18.0/59.2, Abidjan=-16.2/26.0/67.3, ...} like the challenge
+    csv,      // station,min,mean,max,count with a header line; names quoted if needed
+    json,     // [{"station":"Abha","min":-23.0,"mean":18.0,"max":59.2,"count":12345}, ...]
+    binary,   // see result_formatter
+    histogram // station,value,count per value of the distribution with a header line, see distribution
+};
+
+inline auto parse_output_format(std::string_view name) -> std::optional<output_format> {
+    if (name == "table")
+        return output_format::table;
+    if (name == "official")
+        return output_format::official;
+    if (name == "csv")
+        return output_format::csv;
+    if (name == "json")
+        return output_format::json;
+    if (name == "binary")
+        return output_format::binary;
+    if (name == "histogram")
+        return output_format::histogram;
+    return {};
+}
+
+/**
+ * Formats sorted results into one buffer.
+ *
+ * The size of the buffer is bounded in advance, so there is a single
+ * allocation for the whole output and none per station. All values are
+ * printed from integer tenths, the mean rounded half up.
+ *
+ * With a single value column the formats are those of the challenge. With
+ * more columns, min/mean/max are printed for each of them: separated by ';'
+ * (official) or '|' (table), as columns <name>_min,... (csv) or as objects
+ * named after the columns (json).
+ *
+ * With the distribution (see station_statistics::histogram()), table, csv and
+ * json add the standard deviation and the percentiles p50, p95 and p99 of the
+ * first column behind the count; official and binary stay as they are. The
+ * histogram format lists the count of every value which occurred.
+ *
+ * Results grouped by time buckets (see sorted_results) get the start of the
+ * bucket (UTC, 2024-05-01 for days, 2024-05-01T13:00 for hours) behind the
+ * name: as a column named after the bucket (table, csv, histogram), as a
+ * field of the same name (json) or as the key of a nested map per station
+ * (official, {Abha={2024-05-01=-1.0/2.3/5.6, ...}, ...}).
+ *
+ * The binary format is little endian:
+ *
+ *     "1BRC" u32 version (1) u64 number of stations
+ *     per station: u16 name length, name (UTF-8), i16 min, i16 mean, i16 max (tenths), u64 count
+ *
+ * and with more than one column:
+ *
+ *     "1BRC" u32 version (2) u64 number of stations, u16 number of columns, per column: u16 name length, name
+ *     per station: u16 name length, name (UTF-8), per column: i32 min, i32 mean, i32 max (tenths), u64 count
+ *
+ * and grouped by time buckets, with any number of columns:
+ *
+ *     "1BRC" u32 version (3) u64 number of entries, u32 seconds per bucket, u16 number of columns, per column: u16 name length, name
+ *     per entry: u16 name length, name (UTF-8), i64 start of the bucket (seconds since the epoch),
+ *                per column: i32 min, i32 mean, i32 max (tenths), u64 count
+ *
+ * The values of versions 2 and 3 have 32 bits since the further columns have
+ * a wider range than the first one, see column_statistics.
+ */
+class result_formatter {
+public:
+    static constexpr uint32_t BINARY_VERSION = 1;
+    static constexpr uint32_t BINARY_COLUMNS_VERSION = 2;
+    static constexpr uint32_t BINARY_GROUPED_VERSION = 3;
+
+    static constexpr double PERCENTILES[] = {50., 95., 99.};
+
+    /**
+     * @param columns names of the value columns
+     * @param distribution print standard deviation and percentiles; requires the distributions of all stations
+     * @param group_by the results are grouped by these time buckets
+     */
+    explicit result_formatter(output_format format, std::vector<std::string> columns = {"value"}, bool distribution = false,
+                              std::optional<time_bucket> group_by = {})
+        : format_{format}, columns_{std::move(columns)}, distribution_{distribution}, group_by_{group_by} {
+    }
+
+    /**
+     * @return the formatted output; valid until the next call
+     */
+    std::string_view format(std::vector<result_entry> const & entries) {
+        size_t const columns = columns_.size();
+        // JSON escapes take up to 6 bytes per byte
+        size_t bound = 64;
+        size_t per_column = 64;
+        for (auto const & c : columns_) {
+            bound += 6 * c.size() + 32;
+            per_column = std::max(per_column, 6 * c.size() + 64);
+        }
+        for (auto const & e : entries) {
+            bound += 6 * e.name_.size() + 64 + columns * per_column + (distribution_ ? 128 : 0) + (group_by_ ? 48 : 0);
+            if (format_ == output_format::histogram && e.stats_.histogram()) {
+                for (int64_t t = distribution::MIN_TENTHS - 1; t <= distribution::MAX_TENTHS + 1; ++t)
+                    if (e.stats_.histogram()->count(t) > 0)
+                        bound += 2 * e.name_.size() + 32 + (group_by_ ? 48 : 0);
+            }
+        }
+        buffer_.resize(bound);
+        char * p = buffer_.data();
+        switch (format_) {
+            case output_format::table:
+                p = put(p, " **** Statistics ***\n");
+                for (auto const & e : entries) {
+                    p = put(p, e.name_);
+                    p = put_fill(p, 30 - std::min<size_t>(30, code_points(e.name_)));
+                    p = put(p, " ");
+                    if (group_by_) {
+                        p = put_bucket(p, e.bucket_start_);
+                        p = put(p, " ");
+                    }
+                    for (size_t c = 0; c < columns; ++c) {
+                        auto const s = e.stats_.column(c);
+                        p = put_right(p, 5, s.min_tenths(), &result_formatter::put_tenths);
+                        p = put(p, "|");
+                        p = put_right(p, 5, s.avg_tenths(), &result_formatter::put_tenths);
+                        p = put(p, "|");
+                        p = put_right(p, 5, s.max_tenths(), &result_formatter::put_tenths);
+                        p = put(p, "|");
+                    }
+                    p = put_right(p, 6, static_cast<int64_t>(e.stats_.cnt_), &result_formatter::put_integer);
+                    if (distribution_) {
+                        p = put(p, "|");
+                        p = put_right(p, 5, stddev_tenths(e), &result_formatter::put_tenths);
+                        for (auto const percentile : PERCENTILES) {
+                            p = put(p, "|");
+                            p = put_right(p, 5, e.stats_.percentile_tenths(percentile), &result_formatter::put_tenths);
+                        }
+                    }
+                    p = put(p, "\n");
+                }
+                break;
+            case output_format::official:
+                p = put(p, "{");
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    auto const & e = entries[i];
+                    bool const new_station = i == 0 || entries[i - 1].name_ != e.name_;
+                    if (i > 0)
+                        p = put(p, group_by_ && new_station ? "}, " : ", ");
+                    if (new_station || !group_by_) {
+                        p = put(p, e.name_);
+                        p = put(p, group_by_ ? "={" : "=");
+                    }
+                    if (group_by_) {
+                        p = put_bucket(p, e.bucket_start_);
+                        p = put(p, "=");
+                    }
+                    for (size_t c = 0; c < columns; ++c) {
+                        auto const s = e.stats_.column(c);
+                        if (c > 0)
+                            p = put(p, ";");
+                        p = put_tenths(p, s.min_tenths());
+                        p = put(p, "/");
+                        p = put_tenths(p, s.avg_tenths());
+                        p = put(p, "/");
+                        p = put_tenths(p, s.max_tenths());
+                    }
+                }
+                p = put(p, group_by_ && !entries.empty() ? "}}\n" : "}\n");
+                break;
+            case output_format::csv:
+                p = put(p, "station");
+                if (group_by_) {
+                    p = put(p, ",");
+                    p = put(p, time_bucket_name(*group_by_));
+                }
+                if (columns == 1) {
+                    p = put(p, ",min,mean,max,count");
+                } else {
+                    for (auto const & c : columns_) {
+                        for (auto const suffix : {"_min", "_mean", "_max"}) {
+                            std::string const name = c + suffix;
+                            p = put(p, ",");
+                            p = put_csv_field(p, name);
+                        }
+                    }
+                    p = put(p, ",count");
+                }
+                p = put(p, distribution_ ? ",stddev,p50,p95,p99\n" : "\n");
+                for (auto const & e : entries) {
+                    p = put_csv_field(p, e.name_);
+                    if (group_by_) {
+                        p = put(p, ",");
+                        p = put_bucket(p, e.bucket_start_);
+                    }
+                    for (size_t c = 0; c < columns; ++c) {
+                        auto const s = e.stats_.column(c);
+                        p = put(p, ",");
+                        p = put_tenths(p, s.min_tenths());
+                        p = put(p, ",");
+                        p = put_tenths(p, s.avg_tenths());
+                        p = put(p, ",");
+                        p = put_tenths(p, s.max_tenths());
+                    }
+                    p = put(p, ",");
+                    p = put_integer(p, static_cast<int64_t>(e.stats_.cnt_));
+                    if (distribution_) {
+                        p = put(p, ",");
+                        p = put_tenths(p, stddev_tenths(e));
+                        for (auto const percentile : PERCENTILES) {
+                            p = put(p, ",");
+                            p = put_tenths(p, e.stats_.percentile_tenths(percentile));
+                        }
+                    }
+                    p = put(p, "\n");
+                }
+                break;
+            case output_format::json:
+                p = put(p, "[");
+                for (size_t i = 0; i < entries.size(); ++i) {
+                    auto const & e = entries[i];
+                    p = put(p, i > 0 ? ",\n{\"station\":" : "{\"station\":");
+                    p = put_json_string(p, e.name_);
+                    if (group_by_) {
+                        p = put(p, ",\"");
+                        p = put(p, time_bucket_name(*group_by_));
+                        p = put(p, "\":\"");
+                        p = put_bucket(p, e.bucket_start_);
+                        p = put(p, "\"");
+                    }
+                    for (size_t c = 0; c < columns; ++c) {
+                        auto const s = e.stats_.column(c);
+                        if (columns > 1) {
+                            p = put(p, ",");
+                            p = put_json_string(p, columns_[c]);
+                            p = put(p, ":{\"min\":");
+                        } else {
+                            p = put(p, ",\"min\":");
+                        }
+                        p = put_tenths(p, s.min_tenths());
+                        p = put(p, ",\"mean\":");
+                        p = put_tenths(p, s.avg_tenths());
+                        p = put(p, ",\"max\":");
+                        p = put_tenths(p, s.max_tenths());
+                        if (columns > 1)
+                            p = put(p, "}");
+                    }
+                    p = put(p, ",\"count\":");
+                    p = put_integer(p, static_cast<int64_t>(e.stats_.cnt_));
+                    if (distribution_) {
+                        p = put(p, ",\"stddev\":");
+                        p = put_tenths(p, stddev_tenths(e));
+                        for (auto const percentile : PERCENTILES) {
+                            p = put(p, ",\"p");
+                            p = put_integer(p, static_cast<int64_t>(percentile));
+                            p = put(p, "\":");
+                            p = put_tenths(p, e.stats_.percentile_tenths(percentile));
+                        }
+                    }
+                    p = put(p, "}");
+                }
+                p = put(p, "]\n");
+                break;
+            case output_format::binary: {
+                bool const wide = columns > 1 || group_by_; // versions 2 and 3
+                p = put(p, "1BRC");
+                p = put_le<uint32_t>(p, group_by_ ? BINARY_GROUPED_VERSION : columns == 1 ? BINARY_VERSION : BINARY_COLUMNS_VERSION);
+                p = put_le<uint64_t>(p, entries.size());
+                if (group_by_)
+                    p = put_le<uint32_t>(p, static_cast<uint32_t>(bucket_seconds(*group_by_)));
+                if (wide) {
+                    p = put_le<uint16_t>(p, static_cast<uint16_t>(columns));
+                    for (auto const & c : columns_) {
+                        p = put_le<uint16_t>(p, static_cast<uint16_t>(c.size()));
+                        p = put(p, c);
+                    }
+                }
+                for (auto const & e : entries) {
+                    p = put_le<uint16_t>(p, static_cast<uint16_t>(e.name_.size()));
+                    p = put(p, e.name_);
+                    if (group_by_)
+                        p = put_le<int64_t>(p, e.bucket_start_);
+                    for (size_t c = 0; c < columns; ++c) {
+                        auto const s = e.stats_.column(c);
+                        if (wide) {
+                            p = put_le<int32_t>(p, static_cast<int32_t>(s.min_tenths()));
+                            p = put_le<int32_t>(p, static_cast<int32_t>(s.avg_tenths()));
+                            p = put_le<int32_t>(p, static_cast<int32_t>(s.max_tenths()));
+                        } else {
+                            p = put_le<int16_t>(p, static_cast<int16_t>(s.min_tenths()));
+                            p = put_le<int16_t>(p, static_cast<int16_t>(s.avg_tenths()));
+                            p = put_le<int16_t>(p, static_cast<int16_t>(s.max_tenths()));
+                        }
+                    }
+                    p = put_le<uint64_t>(p, static_cast<uint64_t>(e.stats_.cnt_));
+                }
+                break;
+            }
+            case output_format::histogram:
+                p = put(p, "station,");
+                if (group_by_) {
+                    p = put(p, time_bucket_name(*group_by_));
+                    p = put(p, ",");
+                }
+                p = put(p, "value,count\n");
+                for (auto const & e : entries) {
+                    auto const * h = e.stats_.histogram();
+                    if (!h)
+                        continue;
+                    for (int64_t t = distribution::MIN_TENTHS - 1; t <= distribution::MAX_TENTHS + 1; ++t) {
+                        auto const n = h->count(t);
+                        if (n == 0)
+                            continue;
+                        p = put_csv_field(p, e.name_);
+                        p = put(p, ",");
+                        if (group_by_) {
+                            p = put_bucket(p, e.bucket_start_);
+                            p = put(p, ",");
+                        }
+                        if (t < distribution::MIN_TENTHS)
+                            p = put(p, "<");
+                        else if (t > distribution::MAX_TENTHS)
+                            p = put(p, ">");
+                        p = put_tenths(p, std::clamp(t, distribution::MIN_TENTHS, distribution::MAX_TENTHS));
+                        p = put(p, ",");
+                        p = put_integer(p, n);
+                        p = put(p, "\n");
+                    }
+                }
+                break;
+        }
+        return {buffer_.data(), static_cast<size_t>(p - buffer_.data())};
+    }
+
+private:
+    static int64_t stddev_tenths(result_entry const & e) noexcept {
+        return static_cast<int64_t>(std::floor(e.stats_.stddev_tenths() + .5));
+    }
+
+    /** the start of a time bucket: 2024-05-01 for days, 2024-05-01T13:00 for hours */
+    char * put_bucket(char * p, int64_t seconds) const noexcept {
+        auto days = seconds / 86400;
+        auto second_of_day = seconds % 86400;
+        if (second_of_day < 0) {
+            --days;
+            second_of_day += 86400;
+        }
+        auto const date = civil_from_days(days);
+        if (date.year_ >= 0 && date.year_ < 1000)
+            p = put_fill_zeros(p, date.year_ < 10 ? 3 : date.year_ < 100 ? 2 : 1);
+        p = put_integer(p, date.year_);
+        p = put_two_digits(put(p, "-"), date.month_);
+        p = put_two_digits(put(p, "-"), date.day_);
+        if (group_by_ == time_bucket::hour)
+            p = put(put_two_digits(put(p, "T"), static_cast<unsigned>(second_of_day / 3600)), ":00");
+        return p;
+    }
+
+    static char * put_two_digits(char * p, unsigned v) noexcept {
+        *p++ = static_cast<char>('0' + v / 10);
+        *p++ = static_cast<char>('0' + v % 10);
+        return p;
+    }
+
+    static char * put_fill_zeros(char * p, size_t n) noexcept {
+        std::memset(p, '0', n);
+        return p + n;
+    }
+
+    static char * put(char * p, std::string_view s) noexcept {
+        std::memcpy(p, s.data(), s.size());
+        return p + s.size();
+    }
+
+    static char * put_fill(char * p, size_t n) noexcept {
+        std::memset(p, ' ', n);
+        return p + n;
+    }
+
+    static char * put_integer(char * p, int64_t v) noexcept {
+        return std::to_chars(p, p + 24, v).ptr;
+    }
+
+    /** -123 yields -12.3 */
+    static char * put_tenths(char * p, int64_t tenths) noexcept {
+        if (tenths < 0) {
+            *p++ = '-';
+            tenths = -tenths;
+        }
+        p = std::to_chars(p, p + 24, tenths / 10).ptr;
+        *p++ = '.';
+        *p++ = static_cast<char>('0' + tenths % 10);
+        return p;
+    }
+
+    /** print v right aligned in a field of width characters */
+    static char * put_right(char * p, size_t width, int64_t v, char * (*put_value)(char *, int64_t) noexcept) noexcept {
+        char tmp[32];
+        auto const len = static_cast<size_t>(put_value(tmp, v) - tmp);
+        if (len < width)
+            p = put_fill(p, width - len);
+        return put(p, {tmp, len});
+    }
+
+    template<typename T>
+    static char * put_le(char * p, T v) noexcept {
+        auto u = static_cast<std::make_unsigned_t<T>>(v);
+        for (size_t i = 0; i < sizeof(T); ++i, u = static_cast<decltype(u)>(u >> 8))
+            *p++ = static_cast<char>(u & 0xff);
+        return p;
+    }
+
+    static size_t code_points(std::string_view s) noexcept {
+        return static_cast<size_t>(std::count_if(s.begin(), s.end(), [](char c) { return (c & 0xc0) != 0x80; }));
+    }
+
+    static char * put_csv_field(char * p, std::string_view s) noexcept {
+        if (s.find_first_of(",\"\r\n") == std::string_view::npos)
+            return put(p, s);
+        *p++ = '"';
+        for (char c : s) {
+            if (c == '"')
+                *p++ = '"';
+            *p++ = c;
+        }
+        *p++ = '"';
+        return p;
+    }
+
+    static char * put_json_string(char * p, std::string_view s) noexcept {
+        static constexpr char hex[] = "0123456789abcdef";
+        *p++ = '"';
+        for (char c : s) {
+            auto const u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                *p++ = '\\';
+                *p++ = c;
+            } else if (u < 0x20) {
+                p = put(p, "\\u00");
+                *p++ = hex[u >> 4];
+                *p++ = hex[u & 0xf];
+            } else {
+                *p++ = c;
+            }
+        }
+        *p++ = '"';
+        return p;
+    }
+
+    output_format format_;
+    std::vector<std::string> columns_;
+    bool distribution_;
+    std::optional<time_bucket> group_by_;
+    std::vector<char> buffer_;
+};
+
+/**
+ * write all of data to fd, retrying on partial writes and EINTR
+ * @throw std::system_error with the errno of a failed write, e.g. EPIPE or ENOSPC
+ */
+inline void write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        auto const n = ::write(fd, data.data(), data.size());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+}
+
+#endif //RESULT_OUTPUT_H
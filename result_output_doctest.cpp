@@ -0,0 +1,212 @@
+#include <string>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "result_output.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check result output") {
+    using namespace std::string_view_literals;
+    std::vector<station_map> shards(2);
+    auto add = [&shards](std::string_view name, int16_t tenths) {
+        shards[name.size() % 2].add(hashed_key{name, station_map::hash_key(name)}, statistics::from_tenths(tenths));
+    };
+    // the means are exact in tenths, so they are the same with fixed point and float statistics
+    add("Zürich"sv, 123);
+    add("Zürich"sv, 125);
+    add("Abha"sv, -5);
+    add("Abha"sv, -7);
+    add("a \"b\", c"sv, 999);
+    auto const sorted = sorted_results(shards, sort_order::bytes);
+    REQUIRE(sorted.size() == 3);
+    CHECK(sorted[0].name_ == "Abha"sv);
+    CHECK(sorted[1].name_ == "Zürich"sv);
+    CHECK(sorted[2].name_ == "a \"b\", c"sv);
+
+    SUBCASE("table") {
+        result_formatter formatter(output_format::table);
+        CHECK(formatter.format(sorted) ==
+              " **** Statistics ***\n"
+              "Abha                            -0.7| -0.6| -0.5|     2\n"
+              "Zürich                          12.3| 12.4| 12.5|     2\n"
+              "a \"b\", c                        99.9| 99.9| 99.9|     1\n"sv);
+    }
+    SUBCASE("official") {
+        result_formatter formatter(output_format::official);
+        CHECK(formatter.format(sorted) == "{Abha=-0.7/-0.6/-0.5, Zürich=12.3/12.4/12.5, a \"b\", c=99.9/99.9/99.9}\n"sv);
+    }
+    SUBCASE("csv") {
+        result_formatter formatter(output_format::csv);
+        CHECK(formatter.format(sorted) ==
+              "station,min,mean,max,count\n"
+              "Abha,-0.7,-0.6,-0.5,2\n"
+              "Zürich,12.3,12.4,12.5,2\n"
+              "\"a \"\"b\"\", c\",99.9,99.9,99.9,1\n"sv);
+    }
+    SUBCASE("json") {
+        result_formatter formatter(output_format::json);
+        CHECK(formatter.format(sorted) ==
+              "[{\"station\":\"Abha\",\"min\":-0.7,\"mean\":-0.6,\"max\":-0.5,\"count\":2},\n"
+              "{\"station\":\"Zürich\",\"min\":12.3,\"mean\":12.4,\"max\":12.5,\"count\":2},\n"
+              "{\"station\":\"a \\\"b\\\", c\",\"min\":99.9,\"mean\":99.9,\"max\":99.9,\"count\":1}]\n"sv);
+    }
+    SUBCASE("binary") {
+        result_formatter formatter(output_format::binary);
+        auto const out = formatter.format(sorted);
+        CHECK(out.substr(0, 8) == "1BRC\x01\x00\x00\x00"sv);
+        CHECK(out.substr(8, 8) == std::string_view("\x03\0\0\0\0\0\0\0", 8));
+        // Abha: length 4, name, -7, -6, -5, 2
+        CHECK(out.substr(16, 20) == std::string_view("\x04\0Abha\xf9\xff\xfa\xff\xfb\xff\x02\0\0\0\0\0\0\0", 20));
+        CHECK(out.size() == 16 + 3 * 16 + 4 + 7 + 8);
+    }
+}
+
+TEST_CASE("Check result output with distribution") {
+    using namespace std::string_view_literals;
+    std::vector<station_map> shards(1);
+    for (int tenths : {10, 20, 30, 40, -1000}) {
+        auto const value = statistics::from_tenths(static_cast<int16_t>(tenths));
+        shards[0].add<true>(hashed_key{"Abha"sv, station_map::hash_key("Abha"sv)}, value);
+    }
+    auto const sorted = sorted_results(shards, sort_order::bytes);
+
+    SUBCASE("csv") {
+        result_formatter formatter(output_format::csv, {"temp"}, true);
+        CHECK(formatter.format(sorted) ==
+              "station,min,mean,max,count,stddev,p50,p95,p99\n"
+              "Abha,-100.0,-18.0,4.0,5,41.0,2.0,4.0,4.0\n"sv);
+    }
+    SUBCASE("json") {
+        result_formatter formatter(output_format::json, {"temp"}, true);
+        CHECK(formatter.format(sorted) ==
+              "[{\"station\":\"Abha\",\"min\":-100.0,\"mean\":-18.0,\"max\":4.0,\"count\":5,"
+              "\"stddev\":41.0,\"p50\":2.0,\"p95\":4.0,\"p99\":4.0}]\n"sv);
+    }
+    SUBCASE("histogram") {
+        result_formatter formatter(output_format::histogram);
+        CHECK(formatter.format(sorted) ==
+              "station,value,count\n"
+              "Abha,<-99.9,1\n"
+              "Abha,1.0,1\n"
+              "Abha,2.0,1\n"
+              "Abha,3.0,1\n"
+              "Abha,4.0,1\n"sv);
+    }
+}
+
+TEST_CASE("Check result output grouped by time buckets") {
+    using namespace std::string_view_literals;
+    std::vector<station_map> shards(2);
+    std::string key;
+    auto add = [&](size_t shard, std::string_view station, int32_t hour, int16_t tenths) {
+        grouped_key::assign(key, station, hour);
+        shards[shard].add(hashed_key{key, station_map::hash_key(key)}, statistics::from_tenths(tenths));
+    };
+    add(0, "Kairo", 476269, 174);
+    add(1, "Abha", 476270, -10);
+    add(0, "Abha", 476269, 20);
+    add(0, "Abha", 476269, 40);
+    auto const sorted = sorted_results(shards, sort_order::bytes, time_bucket::hour);
+    REQUIRE(sorted.size() == 3);
+    CHECK(sorted[0].name_ == "Abha"sv);
+    CHECK(sorted[0].bucket_start_ == 476269 * int64_t{3600});
+
+    SUBCASE("csv") {
+        result_formatter formatter(output_format::csv, {"temp"}, false, time_bucket::hour);
+        CHECK(formatter.format(sorted) ==
+              "station,hour,min,mean,max,count\n"
+              "Abha,2024-05-01T13:00,2.0,3.0,4.0,2\n"
+              "Abha,2024-05-01T14:00,-1.0,-1.0,-1.0,1\n"
+              "Kairo,2024-05-01T13:00,17.4,17.4,17.4,1\n"sv);
+    }
+    SUBCASE("official") {
+        result_formatter formatter(output_format::official, {"temp"}, false, time_bucket::hour);
+        CHECK(formatter.format(sorted) ==
+              "{Abha={2024-05-01T13:00=2.0/3.0/4.0, 2024-05-01T14:00=-1.0/-1.0/-1.0}, "
+              "Kairo={2024-05-01T13:00=17.4/17.4/17.4}}\n"sv);
+    }
+    SUBCASE("json by day") {
+        std::vector<station_map> days(1);
+        grouped_key::assign(key, "Kairo", 19844);
+        days[0].add(hashed_key{key, station_map::hash_key(key)}, statistics::from_tenths(174));
+        result_formatter formatter(output_format::json, {"temp"}, false, time_bucket::day);
+        CHECK(formatter.format(sorted_results(days, sort_order::bytes, time_bucket::day)) ==
+              "[{\"station\":\"Kairo\",\"day\":\"2024-05-01\",\"min\":17.4,\"mean\":17.4,\"max\":17.4,\"count\":1}]\n"sv);
+    }
+    SUBCASE("binary") {
+        result_formatter formatter(output_format::binary, {"temp"}, false, time_bucket::hour);
+        auto const out = formatter.format(sorted);
+        CHECK(out.substr(0, 28) == std::string_view("1BRC\x03\0\0\0\x03\0\0\0\0\0\0\0\x10\x0e\0\0\x01\0\x04\0temp", 28));
+        CHECK(out.size() == 28 + 3 * (2 + 8 + 12 + 8) + 4 + 4 + 5);
+    }
+}
+
+TEST_CASE("Check result output of several value columns") {
+    using namespace std::string_view_literals;
+    std::vector<station_map> shards(1);
+    auto add = [&shards](std::string_view name, int16_t temp, int16_t humidity) {
+        station_map::column_value_type const values[] = {statistics::from_tenths(temp), statistics::from_tenths(humidity)};
+        shards[0].add(hashed_key{name, station_map::hash_key(name)}, values, 2);
+    };
+    add("Abha"sv, -5, 400);
+    add("Abha"sv, 15, 600);
+    add("Kairo"sv, 174, 201);
+    auto const sorted = sorted_results(shards, sort_order::bytes);
+    std::vector<std::string> const columns{"temp", "humidity"};
+
+    SUBCASE("official") {
+        result_formatter formatter(output_format::official, columns);
+        CHECK(formatter.format(sorted) == "{Abha=-0.5/0.5/1.5;40.0/50.0/60.0, Kairo=17.4/17.4/17.4;20.1/20.1/20.1}\n"sv);
+    }
+    SUBCASE("csv") {
+        result_formatter formatter(output_format::csv, columns);
+        CHECK(formatter.format(sorted) ==
+              "station,temp_min,temp_mean,temp_max,humidity_min,humidity_mean,humidity_max,count\n"
+              "Abha,-0.5,0.5,1.5,40.0,50.0,60.0,2\n"
+              "Kairo,17.4,17.4,17.4,20.1,20.1,20.1,1\n"sv);
+    }
+    SUBCASE("json") {
+        result_formatter formatter(output_format::json, columns);
+        CHECK(formatter.format(sorted) ==
+              "[{\"station\":\"Abha\",\"temp\":{\"min\":-0.5,\"mean\":0.5,\"max\":1.5},\"humidity\":{\"min\":40.0,\"mean\":50.0,\"max\":60.0},\"count\":2},\n"
+              "{\"station\":\"Kairo\",\"temp\":{\"min\":17.4,\"mean\":17.4,\"max\":17.4},\"humidity\":{\"min\":20.1,\"mean\":20.1,\"max\":20.1},\"count\":1}]\n"sv);
+    }
+    SUBCASE("binary") {
+        result_formatter formatter(output_format::binary, columns);
+        auto const out = formatter.format(sorted);
+        CHECK(out.substr(0, 8) == "1BRC\x02\x00\x00\x00"sv);
+        CHECK(out.substr(16, 2) == std::string_view("\x02\0", 2));
+        // header, column names, per station: name, 2 * 3 values, count
+        CHECK(out.size() == 16 + 2 + 2 + 4 + 2 + 8 + 2 + 4 + 24 + 8 + 2 + 5 + 24 + 8);
+    }
+}
+
+TEST_CASE("Check result output of values beyond the range of the first column") {
+    using namespace std::string_view_literals;
+    std::vector<station_map> shards(1);
+    auto add = [&shards](int16_t temp, double pressure) {
+        column_statistics::value_type const values[] = {statistics::from_tenths(temp), *column_statistics::from_double(pressure)};
+        shards[0].add(hashed_key{"Abha"sv, station_map::hash_key("Abha"sv)}, values, 2);
+    };
+    add(123, 101325.);
+    add(-45, 99000.5);
+    auto const sorted = sorted_results(shards, sort_order::bytes);
+    std::vector<std::string> const columns{"temp", "pressure"};
+
+    SUBCASE("csv") {
+        result_formatter formatter(output_format::csv, columns);
+        CHECK(formatter.format(sorted) ==
+              "station,temp_min,temp_mean,temp_max,pressure_min,pressure_mean,pressure_max,count\n"
+              "Abha,-4.5,3.9,12.3,99000.5,100162.8,101325.0,2\n"sv);
+    }
+    SUBCASE("binary") {
+        result_formatter formatter(output_format::binary, columns);
+        auto const out = formatter.format(sorted);
+        auto const station = 16 + 2 + 2 + 4 + 2 + 8;
+        // Abha: length 4, name, temp -45, 39, 123, pressure 990005, 1001628, 1013250, count 2
+        CHECK(out.substr(station, 2 + 4 + 24 + 8) ==
+              std::string_view("\x04\0Abha"
+                               "\xd3\xff\xff\xff\x27\0\0\0\x7b\0\0\0"
+                               "\x35\x1b\x0f\0\x9c\x48\x0f\0\x02\x76\x0f\0"
+                               "\x02\0\0\0\0\0\0\0", 2 + 4 + 24 + 8));
+    }
+}
@@ -0,0 +1,207 @@
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include <fmt/core.h>
+
+/**
+ * Hardware counters of the calling thread read via perf_event_open(2).
+ *
+ * All counters form one group, so they are scheduled together. Only user
+ * space is counted, which is allowed with the default perf_event_paranoid
+ * setting of 2. If the counters are not available (e.g. in a container or a
+ * virtual machine) available() returns false and all values are 0.
+ */
+class perf_counters {
+public:
+    enum counter { cycles, instructions, cache_misses, branch_misses, COUNTER_CNT };
+
+    using values = std::array<uint64_t, COUNTER_CNT>;
+
+    perf_counters() {
+        static constexpr uint64_t configs[COUNTER_CNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (size_t i = 0; i < COUNTER_CNT; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, fds_[0], 0));
+            if (fds_[i] < 0) {
+                close_all();
+                return;
+            }
+        }
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    perf_counters(perf_counters const &) = delete;
+    perf_counters &operator=(perf_counters const &) = delete;
+
+    ~perf_counters() noexcept { close_all(); }
+
+    [[nodiscard]] bool available() const noexcept { return fds_[0] >= 0; }
+
+    /**
+     * @return the counts since construction
+     */
+    [[nodiscard]] values read_values() const noexcept {
+        values result{};
+        struct {
+            uint64_t nr_;
+            uint64_t values_[COUNTER_CNT];
+        } group{};
+        if (available() && ::read(fds_[0], &group, sizeof(group)) == sizeof(group))
+            std::copy(std::begin(group.values_), std::end(group.values_), result.begin());
+        return result;
+    }
+
+private:
+    void close_all() noexcept {
+        for (auto &fd : fds_) {
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+        }
+    }
+
+    int fds_[COUNTER_CNT]{-1, -1, -1, -1};
+};
+
+using stats_clock = std::chrono::steady_clock;
+
+inline double seconds_since(stats_clock::time_point start) noexcept {
+    return std::chrono::duration<double>(stats_clock::now() - start).count();
+}
+
+/**
+ * measurements of one worker thread; the phases add up to its wall time
+ */
+struct thread_stats {
+    double input_s_{0};  // obtaining data: mapping chunks, reading, waiting for or decompressing blocks
+    double scan_s_{0};   // finding delimiters, parsing values and updating the table
+    double wait_s_{0};   // waiting for the other threads to finish scanning
+    double merge_s_{0};  // merging the thread's shard of all tables
+    uint64_t bytes_{0};
+    uint64_t rows_{0};
+    long minor_faults_{0};
+    long major_faults_{0};
+    bool perf_available_{false};
+    perf_counters::values perf_{};
+};
+
+/**
+ * measures the page faults and hardware counters of the calling thread
+ */
+class thread_stats_recorder {
+public:
+    explicit thread_stats_recorder(thread_stats &stats) : stats_{stats}, start_{thread_usage()} {
+    }
+
+    ~thread_stats_recorder() noexcept {
+        auto const end = thread_usage();
+        stats_.minor_faults_ = end.ru_minflt - start_.ru_minflt;
+        stats_.major_faults_ = end.ru_majflt - start_.ru_majflt;
+        stats_.perf_available_ = perf_.available();
+        stats_.perf_ = perf_.read_values();
+    }
+
+private:
+    static rusage thread_usage() noexcept {
+        rusage usage{};
+        getrusage(RUSAGE_THREAD, &usage);
+        return usage;
+    }
+
+    thread_stats &stats_;
+    rusage start_;
+    perf_counters perf_;
+};
+
+/**
+ * measurements of a whole run, printed by --stats
+ */
+struct run_stats {
+    std::vector<thread_stats> threads_;
+    double open_s_{0};      // opening and mapping the input
+    double aggregate_s_{0}; // all worker threads
+    double sort_s_{0};
+    double output_s_{0};
+
+    void print(std::FILE *out) const {
+        fmt::println(out, "\n **** Run statistics ***");
+        fmt::println(out, "{:>6} {:>9} {:>9} {:>9} {:>9} {:>10} {:>10} {:>9} {:>9}",
+                     "thread", "input ms", "scan ms", "wait ms", "merge ms", "MB/s", "Mrows/s", "minflt", "majflt");
+        thread_stats total;
+        for (size_t i = 0; i < threads_.size(); ++i) {
+            auto const &t = threads_[i];
+            print_thread(out, fmt::format("{}", i), t);
+            total.input_s_ += t.input_s_;
+            total.scan_s_ += t.scan_s_;
+            total.wait_s_ += t.wait_s_;
+            total.merge_s_ += t.merge_s_;
+            total.bytes_ += t.bytes_;
+            total.rows_ += t.rows_;
+            total.minor_faults_ += t.minor_faults_;
+            total.major_faults_ += t.major_faults_;
+            for (size_t c = 0; c < perf_counters::COUNTER_CNT; ++c)
+                total.perf_[c] += t.perf_[c];
+            total.perf_available_ |= t.perf_available_;
+        }
+        print_thread(out, "sum", total);
+        if (total.perf_available_) {
+            fmt::println(out, "\n{:>6} {:>14} {:>14} {:>6} {:>12} {:>12}",
+                         "thread", "cycles", "instructions", "IPC", "cache-miss", "branch-miss");
+            for (size_t i = 0; i < threads_.size(); ++i)
+                print_perf(out, fmt::format("{}", i), threads_[i]);
+            print_perf(out, "sum", total);
+        } else {
+            fmt::println(out, "\nHardware counters are not available (see perf_event_paranoid).");
+        }
+        fmt::println(out, "\nopen {:.1f} ms, aggregate {:.1f} ms ({:.1f} MB/s, {:.1f} Mrows/s), sort {:.1f} ms, output {:.1f} ms",
+                     open_s_ * 1e3, aggregate_s_ * 1e3, rate(total.bytes_, aggregate_s_) / 1e6,
+                     rate(total.rows_, aggregate_s_) / 1e6, sort_s_ * 1e3, output_s_ * 1e3);
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        fmt::println(out, "process: {} minor and {} major page faults, max RSS {} MB",
+                     usage.ru_minflt, usage.ru_majflt, usage.ru_maxrss / 1024);
+    }
+
+private:
+    static double rate(uint64_t amount, double seconds) noexcept {
+        return seconds > 0 ? static_cast<double>(amount) / seconds : 0.;
+    }
+
+    static void print_thread(std::FILE *out, std::string const &name, thread_stats const &t) {
+        auto const busy = t.input_s_ + t.scan_s_;
+        fmt::println(out, "{:>6} {:9.1f} {:9.1f} {:9.1f} {:9.1f} {:10.1f} {:10.2f} {:9} {:9}",
+                     name, t.input_s_ * 1e3, t.scan_s_ * 1e3, t.wait_s_ * 1e3, t.merge_s_ * 1e3,
+                     rate(t.bytes_, busy) / 1e6, rate(t.rows_, busy) / 1e6, t.minor_faults_, t.major_faults_);
+    }
+
+    static void print_perf(std::FILE *out, std::string const &name, thread_stats const &t) {
+        auto const &p = t.perf_;
+        auto const ipc = p[perf_counters::cycles] > 0
+            ? static_cast<double>(p[perf_counters::instructions]) / static_cast<double>(p[perf_counters::cycles]) : 0.;
+        fmt::println(out, "{:>6} {:14} {:14} {:6.2f} {:12} {:12}", name, p[perf_counters::cycles],
+                     p[perf_counters::instructions], ipc, p[perf_counters::cache_misses], p[perf_counters::branch_misses]);
+    }
+};
+
+#endif //RUN_STATS_H
@@ -0,0 +1,340 @@
+#ifndef SCAN_INPUT_H
+#define SCAN_INPUT_H
+
+#include <charconv>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <fmt/core.h>
+
+#include "delimiter_scanner.h"
+#include "line_filter.h"
+#include "simple_parse_float.h"
+#include "station_map.h"
+#include "station_table.h"
+#include "statistics.h"
+#include "time_bucket.h"
+
+/** Input File; UTF-8, UNIX line breaks 0x0a
+00000000  4b 61 6e 73 61 73 20 43  69 74 79 3b 2d 30 2e 38  |Kansas City;-0.8|
+00000010  0a 44 61 6d 61 73 63 75  73 3b 31 39 2e 38 0a 4b  |.Damascus;19.8.K|
+00000020  61 6e 73 61 73 20 43 69  74 79 3b 32 38 2e 30 0a  |ansas City;28.0.|
+00000030  4c 61 20 43 65 69 62 61  3b 31 37 2e 30 0a 44 61  |La Ceiba;17.0.Da|
+00000040  72 77 69 6e 3b 32 39 2e  31 0a 4e 65 77 20 59 6f  |rwin;29.1.New Yo|
+00000050  72 6b 20 43 69 74 79 3b  32 2e 31 0a 4c 69 73 62  |rk City;2.1.Lisb|
+...
+*/
+
+
+using agg_map_type = station_map;
+
+/**
+ * thrown for input which does not match the format above
+ */
+class format_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * How the values of the lines are parsed.
+ */
+enum class value_parser {
+    tenths, // swar_parse_tenths: strictly -?\d{1,2}\.\d like the challenge; the fastest
+    decimal // any decimal number (std::from_chars), e.g. 7, -12.25 or 1e2
+};
+
+#ifdef USE_SIMPLE_PARSE_FLOAT
+inline constexpr value_parser default_value_parser = value_parser::tenths;
+#else
+inline constexpr value_parser default_value_parser = value_parser::decimal;
+#endif
+
+inline auto parse_value_parser(std::string_view name) -> std::optional<value_parser> {
+    if (name == "tenths")
+        return value_parser::tenths;
+    if (name == "decimal")
+        return value_parser::decimal;
+    return {};
+}
+
+/**
+ * How the lines are read.
+ */
+struct scan_options {
+    static constexpr size_t MAX_COLUMNS = station_map::MAX_COLUMNS;
+
+    value_parser parser_{default_value_parser};
+    size_t columns_{1}; // values per line: STATION;VALUE[;VALUE...], at most MAX_COLUMNS
+    bool distribution_{false}; // keep the distribution of the first column, see station_statistics::histogram()
+    std::optional<time_bucket> group_by_; // lines start with a timestamp; aggregate per station and bucket, see grouped_key
+    std::shared_ptr<line_filter const> filter_; // only aggregate the lines it accepts
+};
+
+/**
+ * parse the value of the field sv[begin, end), which ends at input offset sv_offset + end
+ * @tparam Stats the statistics the value is added to
+ * @throw format_error if the value cannot be parsed or is out of the range of Stats
+ */
+template<value_parser Parser, typename Stats = statistics>
+auto parse_value(std::string_view sv, size_t begin, size_t end, size_t sv_offset) -> typename Stats::value_type {
+    auto value_view = sv.substr(begin, end - begin);
+    if constexpr (Parser == value_parser::tenths) {
+        auto parse_result = swar_parse_tenths(value_view, sv.size() - begin);
+        if (!parse_result)
+            throw format_error(fmt::format("Broken format in input file: cannot parse float value {} at offset {}", value_view, sv_offset + end));
+        return Stats::from_tenths(parse_result.value());
+    } else {
+        double parsed;
+        auto [ptr, ec] = std::from_chars(value_view.data(), value_view.data() + value_view.size(), parsed);
+        if (ec != std::errc{} || ptr != value_view.data() + value_view.size())
+            throw format_error(fmt::format("Broken format in input file: cannot parse float value {} at offset {}", value_view, sv_offset + end));
+        auto const value = Stats::from_double(parsed);
+        if (!value)
+            throw format_error(fmt::format("Broken format in input file: value {} out of range at offset {}", value_view, sv_offset + end));
+        return *value;
+    }
+}
+
+/**
+ * parse_value for value column c: the first column is kept in the station table as statistics,
+ * the further ones beside it as column_statistics, which may have a wider range
+ */
+template<value_parser Parser>
+auto parse_column(size_t c, std::string_view sv, size_t begin, size_t end, size_t sv_offset) -> column_statistics::value_type {
+    if (c == 0)
+        return parse_value<Parser, statistics>(sv, begin, end, sv_offset);
+    return parse_value<Parser, column_statistics>(sv, begin, end, sv_offset);
+}
+
+/**
+ * see scan_lines
+ * @tparam Distribution also keep the distributions of the values, see scan_options::distribution_
+ * @tparam Filtered only aggregate the lines accepted by filter
+ */
+template<value_parser Parser, bool Distribution, bool Filtered>
+auto scan_lines_with(std::string_view sv, size_t pos, size_t sv_offset, size_t end, agg_map_type & map,
+                     line_filter const * filter) -> size_t {
+    size_t line_start = pos;
+    size_t separator = delimiter_scanner::npos;
+    size_t station_hash = 0;
+    delimiter_scanner scanner(sv, pos);
+    for (size_t d = scanner.next(); d != delimiter_scanner::npos; d = scanner.next()) {
+        if (sv[d] == u8';') {
+            if (separator != delimiter_scanner::npos)
+                throw format_error(fmt::format("Broken format in input file: too many fields at offset {}", sv_offset + d));
+            separator = d;
+            // hash the name while it is hot, independent of parsing the value
+            station_hash = agg_map_type::hash_key(sv.substr(line_start, separator - line_start));
+            continue;
+        }
+        if (separator == delimiter_scanner::npos)
+            throw format_error(fmt::format("Broken format in input file: not 2 fields at offset {}", sv_offset + d));
+        auto station_view = sv.substr(line_start, separator - line_start);
+        if (!Filtered || filter->accepts_station(station_view, station_hash)) {
+            auto const value = parse_value<Parser>(sv, separator + 1, d, sv_offset);
+            column_statistics::value_type const filtered = value;
+            if (!Filtered || filter->accepts_values(&filtered))
+                map.add<Distribution>(hashed_key{station_view, station_hash}, value);
+        }
+        line_start = d + 1;
+        separator = delimiter_scanner::npos;
+        if (sv_offset + line_start >= end)
+            break;
+    }
+    return line_start;
+}
+
+/**
+ * like scan_lines_with, for lines with columns values each
+ */
+template<value_parser Parser, bool Distribution, bool Filtered>
+auto scan_columns_with(std::string_view sv, size_t pos, size_t sv_offset, size_t end, agg_map_type & map,
+                       size_t columns, line_filter const * filter) -> size_t {
+    agg_map_type::column_value_type values[scan_options::MAX_COLUMNS];
+    size_t line_start = pos;
+    size_t field_start = delimiter_scanner::npos; // start of the current value field
+    size_t column = 0;
+    size_t station_end = 0;
+    size_t station_hash = 0;
+    bool rejected = false; // by the station; its values are not parsed
+    delimiter_scanner scanner(sv, pos);
+    for (size_t d = scanner.next(); d != delimiter_scanner::npos; d = scanner.next()) {
+        if (sv[d] == u8';') {
+            if (field_start == delimiter_scanner::npos) {
+                station_end = d;
+                station_hash = agg_map_type::hash_key(sv.substr(line_start, station_end - line_start));
+                if constexpr (Filtered)
+                    rejected = !filter->accepts_station(sv.substr(line_start, station_end - line_start), station_hash);
+            } else {
+                if (column + 1 == columns)
+                    throw format_error(fmt::format("Broken format in input file: too many fields at offset {}", sv_offset + d));
+                if (!rejected)
+                    values[column] = parse_column<Parser>(column, sv, field_start, d, sv_offset);
+                ++column;
+            }
+            field_start = d + 1;
+            continue;
+        }
+        if (field_start == delimiter_scanner::npos || column + 1 != columns)
+            throw format_error(fmt::format("Broken format in input file: not {} fields at offset {}", columns + 1, sv_offset + d));
+        if (!rejected) {
+            values[column] = parse_column<Parser>(column, sv, field_start, d, sv_offset);
+            if (!Filtered || filter->accepts_values(values)) {
+                auto station_view = sv.substr(line_start, station_end - line_start);
+                map.add<Distribution>(hashed_key{station_view, station_hash}, values, columns);
+            }
+        }
+        line_start = d + 1;
+        field_start = delimiter_scanner::npos;
+        column = 0;
+        rejected = false;
+        if (sv_offset + line_start >= end)
+            break;
+    }
+    return line_start;
+}
+
+/**
+ * like scan_columns_with, for lines TIMESTAMP;STATION;VALUE[;VALUE...] which
+ * are aggregated per station and time bucket; the keys are those of grouped_key
+ */
+template<value_parser Parser, bool Distribution, bool Filtered>
+auto scan_grouped_with(std::string_view sv, size_t pos, size_t sv_offset, size_t end, agg_map_type & map,
+                       size_t columns, time_bucket group_by, line_filter const * filter) -> size_t {
+    agg_map_type::column_value_type values[scan_options::MAX_COLUMNS];
+    std::string key;
+    bool rejected = false; // by the station; its values are not parsed
+    size_t line_start = pos;
+    size_t field_start = pos;
+    size_t field = 0; // index of the current field: timestamp, station, values
+    int32_t bucket = 0;
+    delimiter_scanner scanner(sv, pos);
+    for (size_t d = scanner.next(); d != delimiter_scanner::npos; d = scanner.next()) {
+        if (sv[d] == u8';') {
+            if (field == 0) {
+                auto const timestamp_view = sv.substr(line_start, d - line_start);
+                auto const seconds = parse_timestamp(timestamp_view);
+                auto const index = seconds ? bucket_index(*seconds, group_by) : std::nullopt;
+                if (!index)
+                    throw format_error(fmt::format("Broken format in input file: cannot parse timestamp {} at offset {}", timestamp_view, sv_offset + d));
+                bucket = *index;
+            } else if (field == 1) {
+                auto const station_view = sv.substr(field_start, d - field_start);
+                if constexpr (Filtered)
+                    rejected = !filter->accepts_station(station_view, agg_map_type::hash_key(station_view));
+                grouped_key::assign(key, station_view, bucket);
+            } else {
+                if (field == columns + 1)
+                    throw format_error(fmt::format("Broken format in input file: too many fields at offset {}", sv_offset + d));
+                if (!rejected)
+                    values[field - 2] = parse_column<Parser>(field - 2, sv, field_start, d, sv_offset);
+            }
+            ++field;
+            field_start = d + 1;
+            continue;
+        }
+        if (field != columns + 1)
+            throw format_error(fmt::format("Broken format in input file: not {} fields at offset {}", columns + 2, sv_offset + d));
+        if (!rejected) {
+            values[columns - 1] = parse_column<Parser>(columns - 1, sv, field_start, d, sv_offset);
+            if (!Filtered || filter->accepts_values(values))
+                map.add<Distribution>(hashed_key{key, agg_map_type::hash_key(key)}, values, columns);
+        }
+        line_start = d + 1;
+        field_start = line_start;
+        field = 0;
+        rejected = false;
+        if (sv_offset + line_start >= end)
+            break;
+    }
+    return line_start;
+}
+
+/**
+ * scan complete lines and add their values to map
+ * @param sv the buffer
+ * @param pos position in sv where a line starts
+ * @param sv_offset offset of sv in the input; used for error messages and end
+ * @param end stop after the first line which ends at or behind this input offset
+ * @param map the map of aggregated values
+ * @param options how the lines are read
+ * @return position in sv behind the last processed line
+ * @throw format_error if a line does not match the input format
+ */
+inline auto scan_lines(std::string_view sv, size_t pos, size_t sv_offset, size_t end, agg_map_type & map,
+                       scan_options const & options = {}) -> size_t {
+    auto const * filter = options.filter_.get();
+    auto scan = [&]<value_parser Parser, bool Distribution, bool Filtered>() {
+        if (options.group_by_)
+            return scan_grouped_with<Parser, Distribution, Filtered>(sv, pos, sv_offset, end, map, options.columns_, *options.group_by_, filter);
+        if (options.columns_ > 1)
+            return scan_columns_with<Parser, Distribution, Filtered>(sv, pos, sv_offset, end, map, options.columns_, filter);
+        return scan_lines_with<Parser, Distribution, Filtered>(sv, pos, sv_offset, end, map, filter);
+    };
+    auto scan_filtered = [&]<value_parser Parser, bool Distribution>() {
+        return filter ? scan.template operator()<Parser, Distribution, true>()
+                      : scan.template operator()<Parser, Distribution, false>();
+    };
+    if (options.parser_ == value_parser::tenths)
+        return options.distribution_ ? scan_filtered.template operator()<value_parser::tenths, true>()
+                                     : scan_filtered.template operator()<value_parser::tenths, false>();
+    return options.distribution_ ? scan_filtered.template operator()<value_parser::decimal, true>()
+                                 : scan_filtered.template operator()<value_parser::decimal, false>();
+}
+
+/**
+ * scan a part of input and add its values to map
+ * .    .    .    .    .    .    .    .    .    .    .    .    .
+ * Kansas;12.3\München;2.1\Hamburg;13.4\Blabla;34.4\Kairo;17.4\
+ * *########################
+ *                     ####*####################
+ *                                    ##*######################
+ * @param input reader of the input file (mmapped_file or pread_file::reader)
+ * @param start offset in file from where to start; actually start _after_ the first new-line behind start, except if start == 0
+ * @param end pffset in file where to stop; actually continue until the first new-line behind end
+ * @param map the map of aggregated values
+ * @param options how the lines are read
+ */
+template<typename Reader>
+void scan_input(Reader & input, size_t start, size_t end, agg_map_type & map, size_t partition, bool verbose,
+                scan_options const & options = {}) {
+    size_t file_pos = start;
+    size_t skipped = 0;
+    while (file_pos < end) {
+        if (start > 0 && file_pos == start)
+            file_pos--;;
+        auto chunk = input.get_chunk_for_offset(file_pos, end);
+        auto sv = chunk.string_view().substr(chunk.initial_offset_);
+        size_t i = 0;
+        if (start > 0 && file_pos == start - 1) {
+            // search for first new-line
+            auto nl = sv.find(u8'\n');
+            if (nl != std::string_view::npos) {
+                skipped = nl + 1;
+                i += skipped;
+                if (verbose)
+                    fmt::println(stderr, "Partition {:02} skipped {} bytes.", partition, i);
+            } else {
+                std::cerr << "Cannot find start of chunk" << (chunk.chunk_start_ + chunk.initial_offset_) << '\n';
+                throw std::runtime_error("Cannot find start of chunk");
+            }
+        }
+        size_t const sv_offset = chunk.chunk_start_ + chunk.initial_offset_;
+        if (sv_offset + i >= end) {
+            // no line starts within this part; it belongs to the next part
+            file_pos = sv_offset + i;
+            break;
+        }
+        file_pos = sv_offset + scan_lines(sv, i, sv_offset, end, map, options);
+    }
+    if (verbose)
+        fmt::println(stderr, "Partition {:02d} processed from {:12L} to actually {:12L} (end: {:12L})",
+        partition, start + skipped,file_pos, end);
+}
+
+#endif //SCAN_INPUT_H
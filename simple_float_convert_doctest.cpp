@@ -173,4 +173,36 @@ TEST_CASE("Check simple_parse_float2") {
     }
   }
 
-}
\ No newline at end of file
+}
+
+TEST_CASE("Check swar_parse_tenths") {
+  using namespace std::string_view_literals;
+  SUBCASE("all valid values") {
+    for (int tenths = -999; tenths <= 999; ++tenths) {
+      std::string str = fmt::format("{:.1f}", tenths / 10.);
+      if (tenths > -10 && tenths < 0)
+        str = fmt::format("-0.{}", -tenths);
+      auto res = swar_parse_tenths(str);
+      REQUIRE(res);
+      CHECK(res.value() == tenths);
+      // reading the full word from a larger buffer must not change the result
+      std::string padded = str + "\n;9.9;-1.2\n";
+      auto res_padded = swar_parse_tenths(std::string_view(padded).substr(0, str.size()), padded.size());
+      REQUIRE(res_padded);
+      CHECK(res_padded.value() == tenths);
+    }
+  }
+  SUBCASE("invalid values") {
+    std::string_view invalid[] = {
+        ""sv, "1"sv, "12"sv, "."sv, "-"sv, "-."sv, ".5"sv, "-.5"sv, "1."sv, "-1."sv,
+        "123.4"sv, "-123.4"sv, "1.23"sv, "12.34"sv, "1,2"sv, "+1.2"sv, "--1.2"sv,
+        "a.1"sv, "1.a"sv, "1a.2"sv, "1.2 "sv, " 1.2"sv, "1:.2"sv, "1.:"sv, "/.1"sv,
+        "12.3\n"sv, "1.2.3"sv, "12-.3"sv, "-1-.3"sv, "\xc3\xbc.1"sv
+    };
+    for (auto const & e : invalid) {
+      CHECK_FALSE(swar_parse_tenths(e));
+      std::string padded = std::string(e) + "1.2\n";
+      CHECK_FALSE(swar_parse_tenths(std::string_view(padded).substr(0, e.size()), padded.size()));
+    }
+  }
+}
@@ -4,6 +4,10 @@
 
 #ifndef SIMPLE_PARSE_FLOAT_H
 #define SIMPLE_PARSE_FLOAT_H
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <optional>
 #include <string_view>
 #include <array>
@@ -39,4 +43,63 @@ inline auto super_simple_parse_float(std::string_view const &sv)
     res *= sign;
     return {(float)res / 10.f};
 }
+/**
+ * @brief      parse a temperature of the strict format -?\d{1,2}\.\d into an
+ * integer number of tenths (i.e. "-12.3" yields -123) without branches.
+ *
+ * All bytes of the value are loaded into one 64 bit word at once. The position
+ * of the '.' is determined with bit tricks, the digits are validated with SWAR
+ * arithmetic and combined into the result by a single multiplication.
+ *
+ * @param      sv        the input string_view
+ * @param      readable  number of bytes which may be read starting at
+ * sv.data(); if at least 8 the word is loaded directly, otherwise it is copied
+ *
+ * @return     the value in tenths or an empty optional if sv does not match
+ * the format
+ */
+inline auto swar_parse_tenths(std::string_view const &sv, size_t readable)
+    -> std::optional<int16_t>
+{
+    constexpr uint64_t ones = 0x0101010101010101ULL;
+    constexpr uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    size_t const len = sv.size();
+    uint64_t word = 0;
+    if (readable >= 8)
+        std::memcpy(&word, sv.data(), 8);
+    else
+        std::memcpy(&word, sv.data(), std::min(len, readable));
+    if constexpr (std::endian::native == std::endian::big)
+        word = __builtin_bswap64(word);
+    // only keep the bytes of the value itself
+    auto const bytes_below = [](uint64_t n) { return ~uint64_t{0} >> (64 - 8 * n); }; // n in [1, 8]
+    word &= bytes_below(std::clamp<uint64_t>(len, 1, 8));
+
+    uint64_t const neg = (word & 0xff) == u8'-';
+    // exact zero byte detection: high bit of a byte is set iff the byte of x is zero
+    auto const zero_bytes = [](uint64_t x) { return ~(((x & low7) + low7) | x | low7); };
+    uint64_t const dots = zero_bytes(word ^ (ones * u8'.')) & 0x00000000ffffff00ULL; // bytes 1 to 3
+    uint64_t const dot = static_cast<uint64_t>(std::countr_zero(dots)) / 8; // 8 if there is none
+    uint64_t const dot_c = std::min<uint64_t>(dot, 3);
+
+    // all bytes between sign and dot and the byte behind the dot have to be digits
+    uint64_t const digit_bytes = (bytes_below(std::max<uint64_t>(dot_c, 1)) & ~(0xff * neg)) | (0xffULL << (8 * (dot_c + 1)));
+    uint64_t const high_nibbles = (word & (ones * 0xf0)) ^ (ones * 0x30);
+    uint64_t const above_nine = ((word & (ones * 0x0f)) + ones * 0x06) & (ones * 0xf0);
+    uint64_t const int_digits = dot - neg;
+    bool const valid = (dot + 2 == len) & (int_digits >= 1) & (int_digits <= 2)
+        & (((high_nibbles | above_nine) & digit_bytes) == 0);
+
+    // align the dot to byte 3: tens in byte 1, ones in byte 2, tenths in byte 4
+    uint64_t const digits = (((word & ~(0xff * neg)) << (8 * (3 - dot_c))) & 0x0f000f0f00ULL);
+    auto const abs_value = static_cast<int64_t>(((digits * 0x640a0001ULL) >> 32) & 0x3ff);
+    auto const value = static_cast<int16_t>((abs_value ^ -static_cast<int64_t>(neg)) + static_cast<int64_t>(neg));
+    return valid ? std::optional<int16_t>{value} : std::nullopt;
+}
+
+inline auto swar_parse_tenths(std::string_view const &sv)
+    -> std::optional<int16_t>
+{
+    return swar_parse_tenths(sv, sv.size());
+}
 #endif // SIMPLE_PARSE_FLOAT_H
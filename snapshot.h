@@ -0,0 +1,249 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "result_output.h"
+#include "station_map.h"
+#include "station_table.h"
+#include "statistics.h"
+
+/**
+ * The aggregated statistics of the first offset_ bytes of an input file.
+ *
+ * A file which only grows by appending needs to be scanned from offset_ on
+ * only; the result is combined with the stations of the snapshot. To notice
+ * a file which was replaced or rewritten in the meantime, the snapshot keeps
+ * a fingerprint of the bytes before offset_.
+ *
+ * File layout (native byte order, checked by a marker):
+ *
+ *     "1BRCSNAP" u32 version, u32 byte order marker 0x01020304,
+ *     u8 value size, u8 sum size, u8 count size, u8 floating point, i32 scale,
+ *     u64 offset, u64 fingerprint, u16 number of value columns, u64 number of stations,
+ *     per station: u16 name length, name, per column min_, max_, sum_, then cnt_ of column_statistics
+ *
+ * The sizes are those of column_statistics, which represents all columns.
+ */
+struct snapshot {
+    static constexpr std::string_view MAGIC = "1BRCSNAP";
+    static constexpr uint32_t VERSION = 3;
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static constexpr size_t FINGERPRINT_SIZE = 4096;
+
+    uint64_t offset_{0};
+    uint64_t fingerprint_{0};
+    size_t columns_{1};
+    station_map stations_;
+
+    /**
+     * @return hash of the first and the last (up to) FINGERPRINT_SIZE bytes before offset of the file
+     */
+    static uint64_t fingerprint(int fd, uint64_t offset) {
+        std::vector<char> buffer(2 * FINGERPRINT_SIZE);
+        size_t const head = std::min<uint64_t>(offset, FINGERPRINT_SIZE);
+        size_t const tail = std::min<uint64_t>(offset - head, FINGERPRINT_SIZE);
+        read_at(fd, buffer.data(), head, 0);
+        read_at(fd, buffer.data() + head, tail, offset - tail);
+        return simple_hasher{}(buffer.data(), head + tail) ^ offset;
+    }
+
+    /**
+     * @return the offset behind the last new-line before size, i.e. the end of the complete lines
+     */
+    static uint64_t end_of_lines(int fd, uint64_t size) {
+        std::vector<char> buffer(1 << 16);
+        for (uint64_t end = size; end > 0;) {
+            size_t const len = std::min<uint64_t>(end, buffer.size());
+            read_at(fd, buffer.data(), len, end - len);
+            auto const nl = std::string_view(buffer.data(), len).rfind('\n');
+            if (nl != std::string_view::npos)
+                return end - len + nl + 1;
+            end -= len;
+        }
+        return 0;
+    }
+
+    /**
+     * write the stations of all shards to path; replaces the file atomically
+     * @param columns number of value columns of the stations
+     */
+    static void write(std::string const & path, uint64_t offset, uint64_t fingerprint, size_t columns,
+                      std::vector<station_map> const & shards) {
+        std::vector<char> out;
+        size_t stations = 0;
+        for (auto const & shard : shards)
+            stations += shard.size();
+        put(out, MAGIC.data(), MAGIC.size());
+        put_value(out, VERSION);
+        put_value(out, BYTE_ORDER_MARK);
+        put_value(out, static_cast<uint8_t>(sizeof(column_statistics::value_type)));
+        put_value(out, static_cast<uint8_t>(sizeof(column_statistics::sum_)));
+        put_value(out, static_cast<uint8_t>(sizeof(column_statistics::cnt_)));
+        put_value(out, static_cast<uint8_t>(std::is_floating_point_v<column_statistics::value_type>));
+        put_value(out, static_cast<int32_t>(column_statistics::scale));
+        put_value(out, offset);
+        put_value(out, fingerprint);
+        put_value(out, static_cast<uint16_t>(columns));
+        put_value(out, static_cast<uint64_t>(stations));
+        for (auto const & shard : shards) {
+            for (size_t n = 0; n < shard.size(); ++n) {
+                auto const key = shard.key(n);
+                auto const stats = shard.at(n);
+                put_value(out, static_cast<uint16_t>(key.size()));
+                put(out, key.data(), key.size());
+                for (size_t c = 0; c < columns; ++c) {
+                    auto const s = stats.column(c);
+                    put_value(out, s.min_);
+                    put_value(out, s.max_);
+                    put_value(out, s.sum_);
+                }
+                put_value(out, stats.cnt_);
+            }
+        }
+        auto const tmp = path + ".tmp";
+        int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror(tmp.c_str());
+            throw std::runtime_error("Cannot write snapshot");
+        }
+        try {
+            write_all(fd, {out.data(), out.size()});
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        if (fsync(fd) != 0 || close(fd) != 0 || rename(tmp.c_str(), path.c_str()) != 0) {
+            perror(path.c_str());
+            throw std::runtime_error("Cannot write snapshot");
+        }
+    }
+
+    /**
+     * @return the snapshot stored in path or an empty optional if there is none
+     * @throw std::runtime_error if the file is broken or was written by an incompatible build
+     */
+    static auto read(std::string const & path) -> std::optional<snapshot> {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            if (errno == ENOENT)
+                return {};
+            perror(path.c_str());
+            throw std::runtime_error("Cannot read snapshot");
+        }
+        struct stat st{};
+        fstat(fd, &st);
+        std::vector<char> data(static_cast<size_t>(st.st_size));
+        try {
+            read_at(fd, data.data(), data.size(), 0);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+
+        reader in{data.data(), data.data() + data.size()};
+        if (std::string_view(in.take(MAGIC.size()), MAGIC.size()) != MAGIC || in.get<uint32_t>() != VERSION)
+            throw std::runtime_error("Not a snapshot of this version");
+        if (in.get<uint32_t>() != BYTE_ORDER_MARK
+            || in.get<uint8_t>() != sizeof(column_statistics::value_type)
+            || in.get<uint8_t>() != sizeof(column_statistics::sum_)
+            || in.get<uint8_t>() != sizeof(column_statistics::cnt_)
+            || in.get<uint8_t>() != std::is_floating_point_v<column_statistics::value_type>
+            || in.get<int32_t>() != column_statistics::scale)
+            throw std::runtime_error("Snapshot was written by an incompatible build");
+        snapshot result;
+        result.offset_ = in.get<uint64_t>();
+        result.fingerprint_ = in.get<uint64_t>();
+        result.columns_ = in.get<uint16_t>();
+        if (result.columns_ < 1 || result.columns_ > station_map::MAX_COLUMNS)
+            throw std::runtime_error("Broken snapshot: bad number of columns");
+        auto const stations = in.get<uint64_t>();
+        // every station takes at least the length of its name, the columns and the count
+        size_t const min_station_size = sizeof(uint16_t)
+            + result.columns_ * (2 * sizeof(column_statistics::value_type) + sizeof(column_statistics::sum_))
+            + sizeof(column_statistics::cnt_);
+        if (stations > static_cast<size_t>(in.end_ - in.pos_) / min_station_size)
+            throw std::runtime_error("Broken snapshot: truncated");
+        result.stations_.reserve(stations);
+        std::vector<column_statistics> columns(result.columns_, column_statistics{0});
+        for (uint64_t i = 0; i < stations; ++i) {
+            auto const len = in.get<uint16_t>();
+            std::string_view const name(in.take(len), len);
+            for (auto & s : columns) {
+                s.min_ = in.get<column_statistics::value_type>();
+                s.max_ = in.get<column_statistics::value_type>();
+                s.sum_ = in.get<decltype(s.sum_)>();
+            }
+            columns[0].cnt_ = in.get<decltype(columns[0].cnt_)>();
+            if (!fits_first_column(columns[0].min_) || !fits_first_column(columns[0].max_))
+                throw std::runtime_error("Broken snapshot: value out of range");
+            if (!result.stations_.insert(name, columns.data(), columns.size()))
+                throw std::runtime_error("Broken snapshot: duplicate station");
+        }
+        if (in.pos_ != in.end_)
+            throw std::runtime_error("Broken snapshot: trailing data");
+        return result;
+    }
+
+private:
+    static bool fits_first_column(column_statistics::value_type v) noexcept {
+        return static_cast<column_statistics::value_type>(static_cast<statistics::value_type>(v)) == v;
+    }
+
+    struct reader {
+        char const * pos_;
+        char const * end_;
+
+        char const * take(size_t len) {
+            if (static_cast<size_t>(end_ - pos_) < len)
+                throw std::runtime_error("Broken snapshot: truncated");
+            auto const result = pos_;
+            pos_ += len;
+            return result;
+        }
+
+        template<typename T>
+        T get() {
+            T value;
+            std::memcpy(&value, take(sizeof(T)), sizeof(T));
+            return value;
+        }
+    };
+
+    static void put(std::vector<char> & out, char const * data, size_t len) {
+        out.insert(out.end(), data, data + len);
+    }
+
+    template<typename T>
+    static void put_value(std::vector<char> & out, T value) {
+        put(out, reinterpret_cast<char const *>(&value), sizeof(T));
+    }
+
+    static void read_at(int fd, char * buf, size_t len, uint64_t offset) {
+        size_t done = 0;
+        while (done < len) {
+            auto const n = pread(fd, buf + done, len - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error("Cannot read input");
+            done += static_cast<size_t>(n);
+        }
+    }
+};
+
+#endif //SNAPSHOT_H
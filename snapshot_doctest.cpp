@@ -0,0 +1,110 @@
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "snapshot.h"
+#include <doctest/doctest.h>
+
+namespace {
+
+std::string temp_path(char const * name) {
+    return std::string(P_tmpdir) + "/" + name + "." + std::to_string(getpid());
+}
+
+void write_file(std::string const & path, std::string_view data) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    REQUIRE(fd >= 0);
+    write_all(fd, data);
+    close(fd);
+}
+
+} // namespace
+
+TEST_CASE("Check snapshot round trip") {
+    using namespace std::string_view_literals;
+    auto const path = temp_path("snapshot_doctest");
+    auto const add = [](station_map & map, std::string_view name, int16_t tenths) {
+        map.add(hashed_key{name, station_map::hash_key(name)}, statistics::from_tenths(tenths));
+    };
+    std::vector<station_map> shards(2);
+    add(shards[0], "Abha"sv, -5);
+    add(shards[0], "Abha"sv, 123);
+    add(shards[1], "a station with a name longer than 16 bytes"sv, 999);
+    snapshot::write(path, 4711, 42, 1, shards);
+
+    auto loaded = snapshot::read(path);
+    REQUIRE(loaded.has_value());
+    CHECK(loaded->offset_ == 4711);
+    CHECK(loaded->fingerprint_ == 42);
+    CHECK(loaded->stations_.size() == 2);
+    auto const abha = loaded->stations_.find("Abha"sv);
+    REQUIRE(abha.has_value());
+    CHECK(abha->min_tenths() == -5);
+    CHECK(abha->max_tenths() == 123);
+    CHECK(abha->cnt_ == 2);
+    auto const other = loaded->stations_.find("a station with a name longer than 16 bytes"sv);
+    REQUIRE(other.has_value());
+    CHECK(other->avg_tenths() == 999);
+    CHECK(loaded->columns_ == 1);
+
+    SUBCASE("several value columns") {
+        station_map::column_value_type const values[] = {statistics::from_tenths(10), statistics::from_tenths(-20)};
+        std::vector<station_map> columns(1);
+        columns[0].add(hashed_key{"Abha"sv, station_map::hash_key("Abha"sv)}, values, 2);
+        columns[0].add(hashed_key{"Abha"sv, station_map::hash_key("Abha"sv)}, values, 2);
+        snapshot::write(path, 1, 2, 2, columns);
+        auto two = snapshot::read(path);
+        REQUIRE(two.has_value());
+        CHECK(two->columns_ == 2);
+        auto const s = two->stations_.find("Abha"sv);
+        REQUIRE(s.has_value());
+        REQUIRE(s->columns() == 2);
+        CHECK(s->cnt_ == 2);
+        CHECK(s->column(1).sum_ == 2 * statistics::from_tenths(-20));
+        CHECK(s->column(0).max_tenths() == 10);
+    }
+    SUBCASE("truncated") {
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        CHECK_THROWS_AS(snapshot::read(path), std::runtime_error);
+    }
+    SUBCASE("broken number of stations") {
+        // the number of stations follows the header, offset, fingerprint and number of columns
+        auto const pos = snapshot::MAGIC.size() + 4 + 4 + 4 * 1 + 4 + 8 + 8 + 2;
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(pos));
+        file.write("\xff\xff\xff\xff\xff\xff\xff\x0f", 8);
+        file.close();
+        CHECK_THROWS_WITH_AS(snapshot::read(path), "Broken snapshot: truncated", std::runtime_error);
+    }
+    SUBCASE("not a snapshot") {
+        write_file(path, "Abha;12.3\n");
+        CHECK_THROWS_AS(snapshot::read(path), std::runtime_error);
+    }
+    std::remove(path.c_str());
+    CHECK(!snapshot::read(path).has_value());
+}
+
+TEST_CASE("Check snapshot end of lines and fingerprint") {
+    auto const path = temp_path("snapshot_input");
+    write_file(path, "Abha;12.3\nZürich;-1.0\nAbh");
+    int fd = open(path.c_str(), O_RDONLY);
+    REQUIRE(fd >= 0);
+    CHECK(snapshot::end_of_lines(fd, 26) == 23);
+    CHECK(snapshot::end_of_lines(fd, 10) == 10);
+    CHECK(snapshot::end_of_lines(fd, 9) == 0);
+    auto const fingerprint = snapshot::fingerprint(fd, 10);
+    CHECK(fingerprint == snapshot::fingerprint(fd, 10));
+    CHECK(fingerprint != snapshot::fingerprint(fd, 23));
+    close(fd);
+
+    write_file(path, "Abha;12.4\nZürich;-1.0\nAbh");
+    fd = open(path.c_str(), O_RDONLY);
+    REQUIRE(fd >= 0);
+    CHECK(fingerprint != snapshot::fingerprint(fd, 10));
+    close(fd);
+    std::remove(path.c_str());
+}
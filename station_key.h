@@ -0,0 +1,149 @@
+#ifndef STATION_KEY_H
+#define STATION_KEY_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Hashing and comparing station names a word at a time.
+ *
+ * Names are short (mostly up to 16 bytes) and lie in the input buffer, so the
+ * per-byte loops and memcmp calls cost more than the work. The loads below
+ * read whole words or vectors and mask the bytes behind the name. Reading
+ * past the end of a name is only done if the load stays within the same 4KB
+ * page, so it never faults; otherwise the bytes are copied.
+ */
+namespace station_key {
+
+static constexpr size_t PAGE = 4096;
+
+template<size_t N>
+[[nodiscard]] inline bool load_stays_in_page(char const * p) noexcept {
+    return (reinterpret_cast<uintptr_t>(p) & (PAGE - 1)) <= PAGE - N;
+}
+
+/**
+ * @return p, but the compiler no longer knows which object it points to; reading
+ * behind that object is deliberate, so this avoids out of bounds warnings
+ */
+[[nodiscard]] inline char const * hide_bounds(char const * p) noexcept {
+    asm("" : "+r"(p));
+    return p;
+}
+
+/**
+ * @return the len (1 to 7) bytes at p in the low bytes of a word, the other bytes zero
+ */
+__attribute__((no_sanitize_address))
+[[nodiscard]] inline uint64_t load_partial64(char const * p, size_t len) noexcept {
+    uint64_t word = 0;
+    if (load_stays_in_page<8>(p)) {
+        std::memcpy(&word, hide_bounds(p), 8);
+        if constexpr (std::endian::native == std::endian::big)
+            word = __builtin_bswap64(word);
+        return word & ~(~uint64_t{0} << (8 * len));
+    }
+    std::memcpy(&word, p, len);
+    if constexpr (std::endian::native == std::endian::big)
+        word = __builtin_bswap64(word);
+    return word;
+}
+
+[[nodiscard]] inline uint64_t load64(char const * p) noexcept {
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    if constexpr (std::endian::native == std::endian::big)
+        word = __builtin_bswap64(word);
+    return word;
+}
+
+#if defined(__SSE2__)
+/**
+ * @return the len (<= 16) bytes at p, the other bytes of the vector zero
+ */
+__attribute__((no_sanitize_address))
+[[nodiscard]] inline __m128i load_partial128(char const * p, size_t len) noexcept {
+    if (len == 0)
+        return _mm_setzero_si128(); // p may point behind an accessible page
+    __m128i v;
+    if (load_stays_in_page<16>(p)) {
+        v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(hide_bounds(p)));
+    } else {
+        alignas(16) char buf[16]{};
+        std::memcpy(buf, p, len);
+        v = _mm_load_si128(reinterpret_cast<__m128i const *>(buf));
+    }
+    __m128i const index = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_and_si128(v, _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(len)), index));
+}
+
+[[nodiscard]] inline bool equal128(__m128i a, __m128i b) noexcept {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xffff;
+}
+#endif
+
+/**
+ * @param padded 16 bytes: the key, followed by zero bytes
+ * @return whether key (at most 16 bytes) equals the key in padded
+ */
+[[nodiscard]] inline bool equal_padded16(char const * padded, std::string_view key) noexcept {
+#if defined(__SSE2__)
+    return equal128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(padded)), load_partial128(key.data(), key.size()));
+#else
+    return std::memcmp(padded, key.data(), key.size()) == 0;
+#endif
+}
+
+/**
+ * @return whether the len bytes at a and b are equal; one or two vector compares up to 32 bytes
+ */
+[[nodiscard]] inline bool equal(char const * a, char const * b, size_t len) noexcept {
+#if defined(__SSE2__)
+    if (len <= 16)
+        return equal128(load_partial128(a, len), load_partial128(b, len));
+    if (len <= 32)
+        return equal128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(a)), _mm_loadu_si128(reinterpret_cast<__m128i const *>(b)))
+            && equal128(load_partial128(a + 16, len - 16), load_partial128(b + 16, len - 16));
+#endif
+    return std::memcmp(a, b, len) == 0;
+}
+
+} // namespace station_key
+
+/**
+ * Hash mixing 8 bytes per step (multiply, rotate, multiply) with a final
+ * avalanche, so the upper bits used as tags and for the buckets of
+ * station_table depend on all bytes of the name.
+ */
+struct word_hasher {
+    size_t operator()(void const *ptr, size_t len) const noexcept {
+        auto p = static_cast<char const *>(ptr);
+        uint64_t h = 0x9e3779b97f4a7c15ULL ^ (len * 0xff51afd7ed558ccdULL);
+        for (; len >= 8; p += 8, len -= 8)
+            h = mix(h, station_key::load64(p));
+        if (len > 0)
+            h = mix(h, station_key::load_partial64(p, len));
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 29;
+        return static_cast<size_t>(h);
+    }
+
+    size_t operator()(std::string_view const & sv) const noexcept {
+        return this->operator()(sv.data(), sv.size());
+    }
+
+private:
+    static uint64_t mix(uint64_t h, uint64_t word) noexcept {
+        return std::rotl(h ^ (word * 0x87c37b91114253d5ULL), 31) * 0x4cf5ad432745937fULL;
+    }
+};
+
+#endif //STATION_KEY_H
@@ -0,0 +1,52 @@
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "station_key.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check station_key") {
+    using namespace std::string_view_literals;
+    // two pages, the second inaccessible, so reading behind the first page faults
+    auto const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    void * mapping = mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    REQUIRE(mapping != MAP_FAILED);
+    REQUIRE(mprotect(static_cast<char *>(mapping) + page, page, PROT_NONE) == 0);
+    char * const page_end = static_cast<char *>(mapping) + page;
+
+    std::string const name = "Some station name which is longer than 32 bytes";
+    for (size_t len = 0; len <= name.size(); ++len) {
+        auto const key = std::string_view{name}.substr(0, len);
+        char * const at_end = page_end - len; // the key ends at the inaccessible page
+        key.copy(at_end, len);
+        std::string_view const moved{at_end, len};
+
+        CHECK(word_hasher{}(moved) == word_hasher{}(std::string{key}));
+        CHECK(station_key::equal(moved.data(), key.data(), len));
+        if (len > 0) {
+            std::string other{key};
+            other.back() ^= 1;
+            CHECK(!station_key::equal(moved.data(), other.data(), len));
+            CHECK(word_hasher{}(moved) != word_hasher{}(other));
+        }
+        if (len <= 16) {
+            char padded[16]{};
+            key.copy(padded, len);
+            CHECK(station_key::equal_padded16(padded, moved));
+            if (len > 0) {
+                padded[len - 1] ^= 1;
+                CHECK(!station_key::equal_padded16(padded, moved));
+            }
+        }
+    }
+
+    SUBCASE("bytes behind the key are ignored") {
+        std::string const a = "Hamburg;12.0\n";
+        std::string const b = "Hamburg;-3.4\n";
+        CHECK(word_hasher{}(a.data(), 7) == word_hasher{}(b.data(), 7));
+        CHECK(station_key::equal(a.data(), b.data(), 7));
+        CHECK(!station_key::equal(a.data(), b.data(), 9));
+        CHECK(word_hasher{}("Hamburg"sv) != word_hasher{}("Hamburg;"sv));
+    }
+    munmap(mapping, 2 * page);
+}
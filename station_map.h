@@ -0,0 +1,312 @@
+#ifndef STATION_MAP_H
+#define STATION_MAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "distribution.h"
+#include "station_table.h"
+#include "statistics.h"
+
+/**
+ * The statistics of a station over one or more value columns, e.g. for lines
+ * like STATION;TEMP;HUMIDITY;PRESSURE, as found in a basic_station_map.
+ *
+ * The first column is the Stats base, so everything which only knows a single
+ * value per line keeps working. The further columns and the distribution are
+ * referred to where the map keeps them; a basic_station_statistics is only
+ * valid as long as its map is not modified.
+ *
+ * @tparam Stats       statistics of the first column, see basic_statistics
+ * @tparam ColumnStats statistics of the further columns
+ */
+template<typename Stats, typename ColumnStats = Stats>
+class basic_station_statistics : public Stats {
+public:
+    using column_value_type = typename ColumnStats::value_type;
+    using column_sum_type = decltype(ColumnStats::sum_);
+
+    /**
+     * @param first the statistics of the first column
+     * @param columns number of value columns
+     * @param sums, mins, maxs the statistics of the columns - 1 further columns
+     * @param histogram the distribution of the first column or nullptr if it was not kept
+     */
+    basic_station_statistics(Stats const & first, size_t columns, column_sum_type const * sums, column_value_type const * mins,
+                             column_value_type const * maxs, distribution const * histogram) noexcept
+        : Stats{first}, columns_{columns}, sums_{sums}, mins_{mins}, maxs_{maxs}, histogram_{histogram} {
+    }
+
+    [[nodiscard]] size_t columns() const noexcept { return columns_; }
+
+    /**
+     * @return the statistics of column c, which is less than columns()
+     */
+    [[nodiscard]] ColumnStats column(size_t c) const noexcept {
+        if (c == 0) {
+            ColumnStats result{this->min_};
+            result.max_ = this->max_;
+            result.sum_ = static_cast<column_sum_type>(this->sum_);
+            result.cnt_ = this->cnt_;
+            return result;
+        }
+        ColumnStats result{mins_[c - 1]};
+        result.max_ = maxs_[c - 1];
+        result.sum_ = sums_[c - 1];
+        result.cnt_ = this->cnt_;
+        return result;
+    }
+
+    /**
+     * @return the distribution of the first column or nullptr if it was not kept
+     */
+    [[nodiscard]] distribution const * histogram() const noexcept { return histogram_; }
+
+    /**
+     * @return the standard deviation of the first column in tenths; requires histogram()
+     */
+    [[nodiscard]] double stddev_tenths() const noexcept {
+        return histogram_->stddev_tenths(static_cast<double>(this->sum_) * 10. / Stats::scale, this->cnt_);
+    }
+
+    /**
+     * @return the nearest-rank percentile p (in (0, 100]) of the first column in tenths; requires histogram()
+     */
+    [[nodiscard]] int64_t percentile_tenths(double p) const noexcept {
+        return histogram_->percentile_tenths(p, this->cnt_, this->min_tenths(), this->max_tenths());
+    }
+
+private:
+    size_t columns_;
+    column_sum_type const * sums_;
+    column_value_type const * mins_;
+    column_value_type const * maxs_;
+    distribution const * histogram_;
+};
+
+/**
+ * The aggregation table: maps station names to the statistics of their
+ * values.
+ *
+ * The table itself (see station_table) holds nothing but the statistics of
+ * the first value column per station, so the common case of a single column
+ * keeps the small record of fixed_statistics. Everything else is kept out of
+ * line and indexed by the number of the table entry:
+ *
+ * - the further value columns as a struct of arrays: one array of sums, one
+ *   of minima and one of maxima, each holding the values of all further
+ *   columns of an entry next to each other. A line with n values thus
+ *   touches its entry and one small run of each array, however many columns
+ *   there are, and the loop over the columns is a plain vector loop;
+ * - the distributions of the first column (see distribution), if requested.
+ *
+ * Merging combines the entries of the table and then the out of line data of
+ * each merged entry.
+ *
+ * @tparam Stats       statistics of the first column, see basic_statistics
+ * @tparam ColumnStats statistics of the further columns
+ */
+template<typename Stats, typename ColumnStats = Stats>
+class basic_station_map {
+public:
+    using value_type = typename Stats::value_type;
+    using column_value_type = typename ColumnStats::value_type;
+    using column_sum_type = decltype(ColumnStats::sum_);
+    using table_type = station_table<Stats>;
+    using station_statistics = basic_station_statistics<Stats, ColumnStats>;
+
+    static constexpr size_t MAX_COLUMNS = 16;
+
+    explicit basic_station_map(size_t capacity_hint = 1024) : table_{capacity_hint} {
+    }
+
+    [[nodiscard]] static size_t hash_key(std::string_view key) noexcept { return table_type::hash_key(key); }
+
+    [[nodiscard]] static size_t shard_of(size_t hash, size_t shards) noexcept { return table_type::shard_of(hash, shards); }
+
+    /**
+     * add a line with a single value
+     * @tparam Distribution also add the value to the distribution of the station
+     */
+    template<bool Distribution = false>
+    void add(hashed_key hk, value_type const value) {
+        if constexpr (Distribution) {
+            auto const [n, inserted] = table_.try_emplace_entry(hk, value);
+            if (!inserted)
+                table_.entry_at(n).value_.add_value(value);
+            add_to_distribution(n, value);
+        } else {
+            auto const [found, inserted] = table_.try_emplace(hk, value);
+            if (!inserted)
+                found->add_value(value);
+        }
+    }
+
+    /**
+     * add a line with several values
+     * @param values one value per column; the first within the range of value_type
+     * @param columns at most MAX_COLUMNS, the same for all lines
+     * @tparam Distribution also add the first value to the distribution of the station
+     */
+    template<bool Distribution = false>
+    void add(hashed_key hk, column_value_type const * values, size_t columns) {
+        auto const first = static_cast<value_type>(values[0]);
+        auto const [n, inserted] = table_.try_emplace_entry(hk, first);
+        if (inserted) {
+            columns_ = columns;
+            sums_.insert(sums_.end(), values + 1, values + columns);
+            mins_.insert(mins_.end(), values + 1, values + columns);
+            maxs_.insert(maxs_.end(), values + 1, values + columns);
+        } else {
+            table_.entry_at(n).value_.add_value(first);
+            size_t const more = columns - 1;
+            auto * const sum = sums_.data() + n * more;
+            auto * const min = mins_.data() + n * more;
+            auto * const max = maxs_.data() + n * more;
+            for (size_t c = 0; c < more; ++c) {
+                sum[c] += values[c + 1];
+                min[c] = std::min(min[c], values[c + 1]);
+                max[c] = std::max(max[c], values[c + 1]);
+            }
+        }
+        if constexpr (Distribution)
+            add_to_distribution(n, first);
+    }
+
+    /**
+     * insert a station with the statistics of all its columns, e.g. read from a snapshot
+     * @param stats the statistics of columns columns; the count is that of the first
+     * @return false if the station is present already
+     */
+    bool insert(std::string_view key, ColumnStats const * stats, size_t columns) {
+        Stats first{static_cast<value_type>(stats[0].min_)};
+        first.max_ = static_cast<value_type>(stats[0].max_);
+        first.sum_ = static_cast<decltype(first.sum_)>(stats[0].sum_);
+        first.cnt_ = stats[0].cnt_;
+        if (!table_.empty() && columns != columns_)
+            throw std::invalid_argument("Cannot insert a station with another number of columns");
+        if (!table_.try_emplace(key, first).second)
+            return false;
+        columns_ = columns;
+        for (size_t c = 1; c < columns; ++c) {
+            sums_.push_back(stats[c].sum_);
+            mins_.push_back(stats[c].min_);
+            maxs_.push_back(stats[c].max_);
+        }
+        return true;
+    }
+
+    /**
+     * combine all stations of other into this map
+     * @throw std::invalid_argument if both have stations with different numbers of columns
+     */
+    void merge(basic_station_map const & other) {
+        merge_shard(other, 0, 1);
+    }
+
+    /**
+     * combine only those stations of other into this map whose keys belong to shard, see station_table::shard_of
+     */
+    void merge_shard(basic_station_map const & other, size_t shard, size_t shards) {
+        if (other.empty())
+            return;
+        if (empty())
+            columns_ = other.columns_;
+        else if (columns_ != other.columns_)
+            throw std::invalid_argument("Cannot merge stations with " + std::to_string(other.columns_) + " columns into stations with "
+                                        + std::to_string(columns_));
+        size_t const more = columns_ - 1;
+        table_.merge_shard(other.table_, shard, shards, [this, &other, more](size_t from, size_t to, bool inserted) {
+            if (more > 0) {
+                auto const * const sum = other.sums_.data() + from * more;
+                auto const * const min = other.mins_.data() + from * more;
+                auto const * const max = other.maxs_.data() + from * more;
+                if (inserted) {
+                    sums_.insert(sums_.end(), sum, sum + more);
+                    mins_.insert(mins_.end(), min, min + more);
+                    maxs_.insert(maxs_.end(), max, max + more);
+                } else {
+                    for (size_t c = 0; c < more; ++c) {
+                        sums_[to * more + c] += sum[c];
+                        mins_[to * more + c] = std::min(mins_[to * more + c], min[c]);
+                        maxs_[to * more + c] = std::max(maxs_[to * more + c], max[c]);
+                    }
+                }
+            }
+            if (from < other.distributions_.size()) {
+                if (distributions_.size() <= to)
+                    distributions_.resize(table_.size());
+                distributions_[to].combine(other.distributions_[from]);
+            }
+        });
+    }
+
+    /**
+     * make room for at least capacity stations without growing
+     */
+    void reserve(size_t capacity) { table_.reserve(capacity); }
+
+    [[nodiscard]] size_t size() const noexcept { return table_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return table_.empty(); }
+
+    /**
+     * @return the number of value columns of the stations
+     */
+    [[nodiscard]] size_t columns() const noexcept { return columns_; }
+
+    /**
+     * @return the table of the stations with the statistics of their first column
+     */
+    [[nodiscard]] table_type const & table() const noexcept { return table_; }
+
+    /**
+     * @param n the number of a station, i.e. its position in insertion order, less than size()
+     */
+    [[nodiscard]] std::string_view key(size_t n) const noexcept { return table_.entry_at(n).key(); }
+
+    /**
+     * @param n the number of a station, less than size()
+     */
+    [[nodiscard]] station_statistics at(size_t n) const noexcept {
+        size_t const more = columns_ - 1;
+        return station_statistics{table_.entry_at(n).value_, columns_, sums_.data() + n * more, mins_.data() + n * more,
+                                  maxs_.data() + n * more, n < distributions_.size() ? &distributions_[n] : nullptr};
+    }
+
+    [[nodiscard]] auto find(hashed_key hk) const noexcept -> std::optional<station_statistics> {
+        auto const n = table_.find_entry(hk);
+        if (n == table_type::npos)
+            return {};
+        return at(n);
+    }
+
+    [[nodiscard]] auto find(std::string_view key) const noexcept -> std::optional<station_statistics> {
+        return find(hashed_key{key, hash_key(key)});
+    }
+
+private:
+    void add_to_distribution(size_t n, value_type const value) {
+        if (distributions_.size() <= n)
+            distributions_.resize(table_.size());
+        distributions_[n].add(Stats::to_tenths(value));
+    }
+
+    table_type table_;
+    size_t columns_{1};
+    // the columns_ - 1 further columns of entry n at [n * (columns_ - 1), (n + 1) * (columns_ - 1))
+    std::vector<column_sum_type> sums_;
+    std::vector<column_value_type> mins_;
+    std::vector<column_value_type> maxs_;
+    std::vector<distribution> distributions_; // per entry if kept, otherwise empty
+};
+
+using station_statistics = basic_station_statistics<statistics, column_statistics>;
+using station_map = basic_station_map<statistics, column_statistics>;
+
+#endif //STATION_MAP_H
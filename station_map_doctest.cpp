@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "station_map.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check station_map") {
+    using namespace std::string_view_literals;
+    using map = basic_station_map<fixed_statistics>;
+    auto const key = [](std::string_view name) { return hashed_key{name, map::hash_key(name)}; };
+    SUBCASE("single column") {
+        map m;
+        m.add(key("Abha"sv), fixed_statistics::from_tenths(5));
+        m.add(key("Abha"sv), fixed_statistics::from_tenths(-5));
+        m.add(key("Kairo"sv), fixed_statistics::from_tenths(174));
+        CHECK(m.size() == 2);
+        CHECK(m.columns() == 1);
+        CHECK(m.key(1) == "Kairo"sv);
+        auto const abha = m.find("Abha"sv);
+        REQUIRE(abha.has_value());
+        CHECK(abha->columns() == 1);
+        CHECK(abha->column(0).min_tenths() == -5);
+        CHECK(abha->cnt_ == 2);
+        CHECK(abha->histogram() == nullptr);
+        CHECK_FALSE(m.find("Hamburg"sv).has_value());
+        CHECK(m.table().find("Abha"sv)->max_tenths() == 5);
+    }
+    SUBCASE("several columns") {
+        fixed_statistics::value_type const first[] = {10, 200, -30};
+        fixed_statistics::value_type const second[] = {20, 100, -10};
+        map m;
+        m.add(key("Kairo"sv), second, 3);
+        m.add(key("Abha"sv), first, 3);
+        m.add(key("Abha"sv), second, 3);
+        CHECK(m.columns() == 3);
+        auto const s = m.at(1);
+        CHECK(s.columns() == 3);
+        CHECK(s.cnt_ == 2);
+        CHECK(s.column(0).avg_tenths() == 15);
+        CHECK(s.column(1).min_tenths() == 100);
+        CHECK(s.column(1).max_tenths() == 200);
+        CHECK(s.column(2).sum_ == -40);
+        CHECK(s.column(2).cnt_ == 2);
+
+        map other;
+        other.add(key("Hamburg"sv), first, 3);
+        other.add(key("Abha"sv), first, 3);
+        m.merge(other);
+        CHECK(m.size() == 3);
+        auto const abha = m.find("Abha"sv);
+        CHECK(abha->cnt_ == 3);
+        CHECK(abha->column(2).min_tenths() == -30);
+        CHECK(abha->column(1).sum_ == 500);
+        CHECK(m.find("Hamburg"sv)->column(1).sum_ == 200);
+        CHECK(m.find("Kairo"sv)->column(2).max_tenths() == -10);
+
+        map empty;
+        empty.merge(m);
+        CHECK(empty.columns() == 3);
+        CHECK(empty.find("Abha"sv)->column(1).sum_ == 500);
+
+        map single;
+        single.add(key("Abha"sv), fixed_statistics::from_tenths(0));
+        CHECK_THROWS_AS(single.merge(m), std::invalid_argument);
+    }
+    SUBCASE("shards") {
+        fixed_statistics::value_type const values[] = {10, 200};
+        map m;
+        for (auto const name : {"Abha"sv, "Kairo"sv, "Hamburg"sv, "Zürich"sv, "a station with a name longer than 16 bytes"sv})
+            m.add(key(name), values, 2);
+        map shards[2];
+        for (size_t shard = 0; shard < 2; ++shard)
+            shards[shard].merge_shard(m, shard, 2);
+        CHECK(shards[0].size() + shards[1].size() == 5);
+        for (auto const & shard : shards) {
+            for (size_t n = 0; n < shard.size(); ++n) {
+                CHECK(map::shard_of(map::hash_key(shard.key(n)), 2) == static_cast<size_t>(&shard - shards));
+                CHECK(shard.at(n).column(1).max_tenths() == 200);
+            }
+        }
+    }
+    SUBCASE("distribution") {
+        map a;
+        a.add<true>(key("Abha"sv), fixed_statistics::from_tenths(10));
+        a.add(key("Kairo"sv), fixed_statistics::from_tenths(10));
+        CHECK(a.find("Abha"sv)->histogram() != nullptr);
+        map b;
+        b.add<true>(key("Abha"sv), fixed_statistics::from_tenths(30));
+        b.add<true>(key("Abha"sv), fixed_statistics::from_tenths(50));
+        b.add<true>(key("Hamburg"sv), fixed_statistics::from_tenths(50));
+        a.merge(b);
+        auto const abha = a.find("Abha"sv);
+        CHECK(abha->cnt_ == 3);
+        CHECK(abha->percentile_tenths(50) == 30);
+        CHECK(abha->percentile_tenths(99) == 50);
+        CHECK(abha->stddev_tenths() == doctest::Approx(16.33).epsilon(0.001));
+        CHECK(a.find("Hamburg"sv)->histogram()->count(50) == 1);
+    }
+    SUBCASE("insert") {
+        fixed_statistics columns[] = {fixed_statistics{-5}, fixed_statistics{100}};
+        columns[0].max_ = 15;
+        columns[0].sum_ = 10;
+        columns[0].cnt_ = 2;
+        columns[1].sum_ = 300;
+        map m;
+        CHECK(m.insert("Abha"sv, columns, 2));
+        CHECK_FALSE(m.insert("Abha"sv, columns, 2));
+        CHECK_THROWS_AS(m.insert("Kairo"sv, columns, 1), std::invalid_argument);
+        auto const abha = m.find("Abha"sv);
+        CHECK(abha->cnt_ == 2);
+        CHECK(abha->column(0).avg_tenths() == 5);
+        CHECK(abha->column(1).avg_tenths() == 150);
+        CHECK(abha->column(1).cnt_ == 2);
+    }
+}
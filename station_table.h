@@ -0,0 +1,339 @@
+#ifndef STATION_TABLE_H
+#define STATION_TABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "arena.h"
+#include "station_key.h"
+
+struct simple_hasher {
+    size_t operator()(void const *ptr, size_t len) const {
+        auto seed = static_cast<size_t>(0xc70f6907UL);
+        auto const c = static_cast<unsigned char const *>(ptr);
+        for (size_t i = 0; i < len; ++i)
+            seed = 31 * seed + c[i];
+        return seed;
+    }
+    size_t operator()(std::string_view const & sv) const {
+        return this->operator()(sv.data(), sv.length());
+    }
+};
+
+/**
+ * a station name together with its precomputed hash
+ */
+struct hashed_key {
+    std::string_view key_;
+    size_t hash_;
+};
+
+/**
+ * Flat hash table mapping station names to values.
+ *
+ * The table consists of a dense array of entries (in insertion order) and a
+ * power-of-two sized index of slots which is probed linearly. Each slot holds
+ * the upper 32 bits of the full hash and the number of its entry, so almost
+ * all mismatches are rejected without touching the entry itself. Every entry
+ * caches its full hash, which makes growing the index and merging tables cheap.
+ *
+ * Keys of up to INLINE_KEY_SIZE bytes are stored inline in the entry, longer
+ * keys (up to 100 bytes in the challenge) are copied into an arena, so they
+ * need no allocation of their own and lie close together. The arena may be
+ * shared by all tables of a thread. Merging tables does not copy long keys
+ * again: the entries point into the arenas of the merged tables, which are
+ * kept alive by shared ownership and released in bulk with the last table.
+ * The values themselves live in the dense entries, i.e. in one allocation.
+ * An entry keeps its number (its position in insertion order) for the life of
+ * the table, so data kept outside of the table can be indexed by it, see
+ * try_emplace_entry() and merge() with a callback.
+ *
+ * Keys are compared with one or two vector compares up to 32 bytes, see
+ * station_key.h; the default hash (word_hasher) mixes 8 bytes per step.
+ *
+ * The table grows by doubling the index as soon as it is half full. Since the
+ * hashes are cached, this only rebuilds the index from the dense entries and
+ * never hashes or compares a key again; reserve() avoids even that if the
+ * number of keys is known in advance.
+ *
+ * @tparam Value  the mapped type; merge() requires Value::combine(Value const &)
+ * @tparam Hasher functor computing the hash of a std::string_view
+ */
+template<typename Value, typename Hasher = word_hasher>
+class station_table {
+public:
+    static constexpr size_t INLINE_KEY_SIZE = 16;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    class entry {
+    public:
+        template<typename... Args>
+        entry(std::string_view key, size_t hash, char const * long_key, Args &&... args)
+            : hash_{hash}, len_{static_cast<uint32_t>(key.size())}, value_(std::forward<Args>(args)...) {
+            if (key.size() <= INLINE_KEY_SIZE) {
+                std::memset(inline_key_, 0, INLINE_KEY_SIZE);
+                std::memcpy(inline_key_, key.data(), key.size());
+            } else {
+                long_key_ = long_key;
+            }
+        }
+
+        [[nodiscard]] std::string_view key() const noexcept {
+            return {len_ <= INLINE_KEY_SIZE ? inline_key_ : long_key_, len_};
+        }
+
+        [[nodiscard]] size_t hash() const noexcept { return hash_; }
+
+        [[nodiscard]] bool matches(std::string_view key, size_t hash) const noexcept {
+            if (hash_ != hash || len_ != key.size())
+                return false;
+            return len_ <= INLINE_KEY_SIZE ? station_key::equal_padded16(inline_key_, key)
+                                           : station_key::equal(long_key_, key.data(), len_);
+        }
+
+    private:
+        size_t hash_;
+        uint32_t len_;
+        union {
+            char inline_key_[INLINE_KEY_SIZE];
+            char const * long_key_;
+        };
+
+    public:
+        Value value_;
+    };
+
+    using iterator = typename std::vector<entry>::iterator;
+    using const_iterator = typename std::vector<entry>::const_iterator;
+
+    /**
+     * @param keys arena for the long keys, e.g. shared by all tables of a thread; a table creates its own if null
+     */
+    explicit station_table(size_t capacity_hint = 1024, std::shared_ptr<arena> keys = nullptr) : keys_{std::move(keys)} {
+        size_t slots = MIN_SLOTS;
+        while (slots < 2 * capacity_hint)
+            slots *= 2;
+        resize_index(slots);
+        entries_.reserve(capacity_hint);
+    }
+
+    station_table(station_table const &) = delete;
+    station_table &operator=(station_table const &) = delete;
+    station_table(station_table &&) noexcept = default;
+    station_table &operator=(station_table &&) noexcept = default;
+
+    [[nodiscard]] static size_t hash_key(std::string_view key) noexcept { return Hasher{}(key); }
+
+    /**
+     * make room for at least capacity entries without growing
+     */
+    void reserve(size_t capacity) {
+        size_t slots = slots_.size();
+        while (slots < 2 * capacity)
+            slots *= 2;
+        if (slots != slots_.size())
+            resize_index(slots);
+        entries_.reserve(capacity);
+    }
+
+    /**
+     * @return pointer to the value stored for key or nullptr
+     */
+    [[nodiscard]] Value const * find(hashed_key hk) const noexcept {
+        auto const n = find_entry(hk);
+        return n == npos ? nullptr : &entries_[n].value_;
+    }
+
+    [[nodiscard]] Value * find(hashed_key hk) noexcept { return const_cast<Value *>(std::as_const(*this).find(hk)); }
+
+    [[nodiscard]] Value const * find(std::string_view key) const noexcept { return find(hashed_key{key, hash_key(key)}); }
+    [[nodiscard]] Value * find(std::string_view key) noexcept { return find(hashed_key{key, hash_key(key)}); }
+
+    /**
+     * @return the number of the entry of key (see entry_at) or npos
+     */
+    [[nodiscard]] size_t find_entry(hashed_key hk) const noexcept {
+        auto const [key, hash] = hk;
+        for (size_t pos = bucket(hash);; pos = (pos + 1) & mask_) {
+            auto const & s = slots_[pos];
+            if (s.index_ == 0)
+                return npos;
+            if (s.tag_ == tag(hash) && entries_[s.index_ - 1].matches(key, hash))
+                return s.index_ - 1;
+        }
+    }
+
+    /**
+     * Look up key and construct a new value from args if it is not present yet.
+     * @return pointer to the value and whether it was newly inserted
+     */
+    template<typename... Args>
+    auto try_emplace(hashed_key hk, Args &&... args) -> std::pair<Value *, bool> {
+        auto const [n, inserted] = emplace(hk, false, std::forward<Args>(args)...);
+        return {&entries_[n].value_, inserted};
+    }
+
+    template<typename... Args>
+    auto try_emplace(std::string_view key, Args &&... args) -> std::pair<Value *, bool> {
+        return try_emplace(hashed_key{key, hash_key(key)}, std::forward<Args>(args)...);
+    }
+
+    /**
+     * like try_emplace
+     * @return the number of the entry (see entry_at) and whether it was newly inserted
+     */
+    template<typename... Args>
+    auto try_emplace_entry(hashed_key hk, Args &&... args) -> std::pair<size_t, bool> {
+        return emplace(hk, false, std::forward<Args>(args)...);
+    }
+
+    /**
+     * combine all values of other into this table; long keys are not copied
+     * but referenced, the table keeps the arenas of other alive
+     */
+    void merge(station_table const & other) {
+        merge(other, [](size_t, size_t, bool) {});
+    }
+
+    /**
+     * like merge; calls merged(entry number in other, entry number in this table, newly inserted)
+     * after each value, e.g. to merge data kept outside the table by entry number
+     */
+    template<typename Merged>
+    void merge(station_table const & other, Merged merged) {
+        merge_shard(other, 0, 1, merged);
+    }
+
+    /**
+     * @return the shard in [0, shards) a key with the given hash belongs to
+     */
+    [[nodiscard]] static size_t shard_of(size_t hash, size_t shards) noexcept {
+        return static_cast<size_t>((static_cast<uint64_t>(tag(hash)) * shards) >> 32);
+    }
+
+    /**
+     * combine only those values of other into this table whose keys belong to shard
+     */
+    void merge_shard(station_table const & other, size_t shard, size_t shards) {
+        merge_shard(other, shard, shards, [](size_t, size_t, bool) {});
+    }
+
+    /**
+     * like merge_shard; calls merged as merge does
+     */
+    template<typename Merged>
+    void merge_shard(station_table const & other, size_t shard, size_t shards, Merged merged) {
+        borrow_keys(other);
+        for (size_t i = 0; i < other.entries_.size(); ++i) {
+            auto const & e = other.entries_[i];
+            if (shards > 1 && shard_of(e.hash(), shards) != shard)
+                continue;
+            auto const [n, inserted] = emplace(hashed_key{e.key(), e.hash()}, true, e.value_);
+            if (!inserted)
+                entries_[n].value_.combine(e.value_);
+            merged(i, n, inserted);
+        }
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return entries_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return entries_.empty(); }
+
+    /**
+     * @param n the number of an entry, i.e. its position in insertion order, less than size()
+     */
+    [[nodiscard]] entry & entry_at(size_t n) noexcept { return entries_[n]; }
+    [[nodiscard]] entry const & entry_at(size_t n) const noexcept { return entries_[n]; }
+
+    iterator begin() noexcept { return entries_.begin(); }
+    iterator end() noexcept { return entries_.end(); }
+    const_iterator begin() const noexcept { return entries_.begin(); }
+    const_iterator end() const noexcept { return entries_.end(); }
+
+private:
+    struct slot {
+        uint32_t tag_;
+        uint32_t index_; // entry number + 1, 0 marks an empty slot
+    };
+
+    static constexpr size_t MIN_SLOTS = 16;
+
+    static uint32_t tag(size_t hash) noexcept { return static_cast<uint32_t>(hash >> 32); }
+
+    // fibonacci hashing spreads the low quality bits of simple hashes over the whole index
+    [[nodiscard]] size_t bucket(size_t hash) const noexcept {
+        return static_cast<size_t>((hash * 0x9e3779b97f4a7c15ULL) >> shift_);
+    }
+
+    /**
+     * @param stable_key key points into an arena which this table keeps alive; otherwise a long key is copied
+     */
+    template<typename... Args>
+    auto emplace(hashed_key hk, bool stable_key, Args &&... args) -> std::pair<size_t, bool> {
+        auto const [key, hash] = hk;
+        size_t pos = bucket(hash);
+        for (;; pos = (pos + 1) & mask_) {
+            auto const & s = slots_[pos];
+            if (s.index_ == 0)
+                break;
+            if (s.tag_ == tag(hash) && entries_[s.index_ - 1].matches(key, hash))
+                return {s.index_ - 1, false};
+        }
+        char const * long_key = nullptr;
+        if (key.size() > INLINE_KEY_SIZE) {
+            if (stable_key) {
+                long_key = key.data();
+            } else {
+                if (!keys_)
+                    keys_ = std::make_shared<arena>();
+                long_key = keys_->store(key).data();
+            }
+        }
+        entries_.emplace_back(key, hash, long_key, std::forward<Args>(args)...);
+        slots_[pos] = slot{tag(hash), static_cast<uint32_t>(entries_.size())};
+        if (2 * entries_.size() > slots_.size())
+            resize_index(2 * slots_.size());
+        return {entries_.size() - 1, true};
+    }
+
+    /**
+     * keep the arenas holding the long keys of other alive as long as this table
+     */
+    void borrow_keys(station_table const & other) {
+        auto borrow = [this](std::shared_ptr<arena const> const & a) {
+            if (a && a != keys_ && std::find(borrowed_.begin(), borrowed_.end(), a) == borrowed_.end())
+                borrowed_.push_back(a);
+        };
+        borrow(other.keys_);
+        for (auto const & a : other.borrowed_)
+            borrow(a);
+    }
+
+    void resize_index(size_t slots) {
+        slots_.assign(slots, slot{0, 0});
+        mask_ = slots - 1;
+        shift_ = 64;
+        for (size_t s = slots; s > 1; s >>= 1)
+            --shift_;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            size_t pos = bucket(entries_[i].hash());
+            while (slots_[pos].index_ != 0)
+                pos = (pos + 1) & mask_;
+            slots_[pos] = slot{tag(entries_[i].hash()), static_cast<uint32_t>(i + 1)};
+        }
+    }
+
+    std::vector<slot> slots_;
+    std::vector<entry> entries_;
+    std::shared_ptr<arena> keys_;                      // stores the keys longer than INLINE_KEY_SIZE
+    std::vector<std::shared_ptr<arena const>> borrowed_; // arenas of merged tables whose long keys are referenced
+    size_t mask_{0};
+    unsigned shift_{64};
+};
+
+#endif //STATION_TABLE_H
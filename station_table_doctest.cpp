@@ -0,0 +1,150 @@
+#include <map>
+#include <random>
+#include <vector>
+#include <string>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "station_table.h"
+#include "statistics.h"
+#include <doctest/doctest.h>
+
+struct constant_hasher {
+    size_t operator()(std::string_view const &) const { return 42; }
+};
+
+TEST_CASE("Check station_table") {
+    using namespace std::string_view_literals;
+    SUBCASE("insert and find") {
+        station_table<int> table(4);
+        CHECK(table.empty());
+        auto [v1, inserted1] = table.try_emplace("Hamburg"sv, 1);
+        CHECK(inserted1);
+        CHECK(*v1 == 1);
+        auto [v2, inserted2] = table.try_emplace("Hamburg"sv, 2);
+        CHECK_FALSE(inserted2);
+        CHECK(*v2 == 1);
+        CHECK(table.size() == 1);
+        CHECK(table.find("Hamburg"sv) != nullptr);
+        CHECK(table.find("Hamburg "sv) == nullptr);
+        CHECK(table.find("Hambur"sv) == nullptr);
+        CHECK(table.find(""sv) == nullptr);
+    }
+    SUBCASE("long keys and empty key") {
+        station_table<int> table;
+        std::string long_name(100, 'x');
+        long_name.back() = 'y';
+        table.try_emplace(long_name, 1);
+        table.try_emplace(std::string(100, 'x'), 2);
+        table.try_emplace(""sv, 3);
+        REQUIRE(table.find(long_name) != nullptr);
+        CHECK(*table.find(long_name) == 1);
+        CHECK(*table.find(std::string(100, 'x')) == 2);
+        CHECK(*table.find(""sv) == 3);
+        for (auto const & e : table)
+            CHECK(e.key().size() == (e.value_ == 3 ? 0 : 100));
+    }
+    SUBCASE("growing keeps all entries") {
+        station_table<size_t> table(1);
+        std::map<std::string, size_t> reference;
+        std::mt19937_64 rnd{4711};
+        for (size_t i = 0; i < 20'000; ++i) {
+            std::string key = "station " + std::to_string(rnd() % 5'000) + std::string(rnd() % 40, '#');
+            auto [value, inserted] = table.try_emplace(key, size_t{0});
+            ++*value;
+            ++reference[key];
+            CHECK(inserted == (reference[key] == 1));
+        }
+        CHECK(table.size() == reference.size());
+        for (auto const & [key, cnt] : reference) {
+            REQUIRE(table.find(key) != nullptr);
+            CHECK(*table.find(key) == cnt);
+        }
+    }
+    SUBCASE("many long keys") {
+        // the worst case of the challenge: 10'000 stations with names of up to 100 bytes
+        station_table<size_t> table;
+        table.reserve(10'000);
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < 10'000; ++i)
+            keys.push_back(std::to_string(i) + std::string(1 + i % 100, 'x').substr(std::to_string(i).size() % 2));
+        for (size_t i = 0; i < keys.size(); ++i)
+            CHECK(table.try_emplace(keys[i], i).second);
+        station_table<size_t> moved(std::move(table));
+        moved.try_emplace(std::string(200, 'y'), size_t{4711});
+        CHECK(moved.size() == keys.size() + 1);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            REQUIRE(moved.find(keys[i]) != nullptr);
+            CHECK(*moved.find(keys[i]) == i);
+        }
+        CHECK(*moved.find(std::string(200, 'y')) == 4711);
+    }
+    SUBCASE("colliding hashes") {
+        station_table<int, constant_hasher> table;
+        for (int i = 0; i < 100; ++i)
+            table.try_emplace(std::to_string(i), i);
+        CHECK(table.size() == 100);
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(table.find(std::to_string(i)) != nullptr);
+            CHECK(*table.find(std::to_string(i)) == i);
+        }
+        CHECK(table.find("100"sv) == nullptr);
+    }
+    SUBCASE("merging tables") {
+        station_table<statistics> a, b;
+        a.try_emplace("Abha"sv, statistics::from_tenths(10));
+        a.try_emplace("Zürich"sv, statistics::from_tenths(-20));
+        b.try_emplace("Zürich"sv, statistics::from_tenths(40));
+        b.try_emplace("Dar es Salaam and a really long suffix"sv, statistics::from_tenths(30));
+        a.merge(b);
+        CHECK(a.size() == 3);
+        auto zurich = a.find("Zürich"sv);
+        REQUIRE(zurich != nullptr);
+        CHECK(zurich->cnt_ == 2);
+        CHECK(zurich->min() == doctest::Approx(-2.));
+        CHECK(zurich->max() == doctest::Approx(4.));
+        CHECK(zurich->avg() == doctest::Approx(1.));
+        CHECK(a.find("Dar es Salaam and a really long suffix"sv) != nullptr);
+    }
+    SUBCASE("merging shards") {
+        static constexpr size_t shards = 3;
+        station_table<statistics> a, b;
+        for (int i = 0; i < 1000; ++i) {
+            a.try_emplace(std::to_string(i), statistics::from_tenths(static_cast<int16_t>(i)));
+            b.try_emplace(std::to_string(i + 500), statistics::from_tenths(static_cast<int16_t>(-i)));
+        }
+        station_table<statistics> result[shards];
+        size_t total = 0;
+        for (size_t shard = 0; shard < shards; ++shard) {
+            result[shard].merge_shard(a, shard, shards);
+            result[shard].merge_shard(b, shard, shards);
+            for (auto const & e : result[shard])
+                CHECK(station_table<statistics>::shard_of(e.hash(), shards) == shard);
+            total += result[shard].size();
+        }
+        CHECK(total == 1500);
+        size_t const shard = station_table<statistics>::shard_of(station_table<statistics>::hash_key("700"sv), shards);
+        auto found = result[shard].find("700"sv);
+        REQUIRE(found != nullptr);
+        CHECK(found->cnt_ == 2);
+        CHECK(found->min() == doctest::Approx(-20.));
+        CHECK(found->max() == doctest::Approx(70.));
+    }
+    SUBCASE("merged long keys outlive their table") {
+        auto const name = std::string(40, 'x');
+        station_table<statistics> result;
+        {
+            auto keys = std::make_shared<arena>();
+            station_table<statistics> a(16, keys), b(16, keys);
+            a.try_emplace(name, statistics::from_tenths(10));
+            b.try_emplace(name + "y", statistics::from_tenths(20));
+            CHECK(keys->bytes_used() == 2 * name.size() + 1);
+            result.merge(a);
+            result.merge(b);
+        }
+        auto found = result.find(name);
+        REQUIRE(found != nullptr);
+        CHECK(found->cnt_ == 1);
+        REQUIRE(result.find(name + "y") != nullptr);
+        station_table<statistics> moved(std::move(result));
+        CHECK(moved.begin()->key() == name);
+    }
+}
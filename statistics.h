@@ -5,38 +5,142 @@
 #ifndef STATISTICS_H
 #define STATISTICS_H
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <ostream>
+#include <type_traits>
 
-struct statistics {
-    explicit statistics(float const value) : min_{value}, max_{value}, sum_{value}, cnt_{1} {
+/**
+ * min/max/sum/count of the values of one station.
+ *
+ * @tparam Value  type of single values and of min_/max_
+ * @tparam Sum    type of the accumulated sum_
+ * @tparam Count  type of the counter cnt_
+ * @tparam Scale  values are stored multiplied by Scale, e.g. 10 for integer tenths
+ */
+template<typename Value, typename Sum, typename Count, int Scale>
+struct basic_statistics {
+    using value_type = Value;
+    static constexpr int scale = Scale;
+
+    explicit basic_statistics(Value const value) : min_{value}, max_{value}, sum_{value}, cnt_{1} {
     }
 
-    statistics(statistics const &) = default;
+    basic_statistics(basic_statistics const &) = default;
+
+    static Value from_tenths(int16_t tenths) noexcept {
+        if constexpr (std::is_floating_point_v<Value>)
+            return static_cast<Value>(tenths) / static_cast<Value>(10) * static_cast<Value>(Scale);
+        else
+            return static_cast<Value>(tenths * Scale / 10);
+    }
 
-    void add_value(float const &value) noexcept {
+    /**
+     * @return value in the representation of the statistics, rounded to the nearest multiple of 1 / Scale
+     * for integer values, or nothing if it is outside the range of Value
+     */
+    static std::optional<Value> from_double(double value) noexcept {
+        if constexpr (std::is_floating_point_v<Value>) {
+            return static_cast<Value>(value * Scale);
+        } else {
+            auto const scaled = std::round(value * Scale);
+            if (!(scaled >= std::numeric_limits<Value>::lowest() && scaled <= std::numeric_limits<Value>::max()))
+                return {};
+            return static_cast<Value>(scaled);
+        }
+    }
+
+    void add_value(Value const &value) noexcept {
         min_ = std::min(value, min_);
         max_ = std::max(value, max_);
         sum_ += value;
         ++cnt_;
     }
 
-    void combine(statistics const & other) {
+    void combine(basic_statistics const & other) {
         cnt_ += other.cnt_;
         min_ = std::min(min_, other.min_);
         max_ = std::max(max_, other.max_);
         sum_ += other.sum_;
     }
 
-    float min_;
-    float max_;
-    float sum_;
-    unsigned cnt_;
+    Value min_;
+    Value max_;
+    Sum sum_;
+    Count cnt_;
+
+    [[nodiscard]] double min() const noexcept { return static_cast<double>(min_) / Scale; }
+    [[nodiscard]] double max() const noexcept { return static_cast<double>(max_) / Scale; }
+
+    /**
+     * For integer values the mean is rounded half up to a multiple of 1 / Scale
+     * here, i.e. only at output time.
+     */
+    [[nodiscard]] double avg() const noexcept {
+        if constexpr (std::is_floating_point_v<Sum>) {
+            return static_cast<double>(sum_ / static_cast<Sum>(cnt_)) / Scale;
+        } else {
+            // floor((2 * sum + cnt) / (2 * cnt)) == round half up of sum / cnt
+            auto const num = 2 * static_cast<int64_t>(sum_) + static_cast<int64_t>(cnt_);
+            auto const den = 2 * static_cast<int64_t>(cnt_);
+            auto q = num / den;
+            if (num % den < 0)
+                --q;
+            return static_cast<double>(q) / Scale;
+        }
+    }
+
+    /** min, max and mean as integer tenths, rounded half up; used by the output formats */
+    [[nodiscard]] int64_t min_tenths() const noexcept { return to_tenths(min_); }
+    [[nodiscard]] int64_t max_tenths() const noexcept { return to_tenths(max_); }
 
-    [[nodiscard]] float avg() const noexcept { return sum_ / static_cast<float>(cnt_); }
+    [[nodiscard]] int64_t avg_tenths() const noexcept {
+        if constexpr (std::is_floating_point_v<Sum>) {
+            return static_cast<int64_t>(std::floor(static_cast<double>(sum_) / static_cast<double>(cnt_) * 10. / Scale + .5));
+        } else {
+            // floor((20 * sum + cnt * Scale) / (2 * cnt * Scale)) == round half up of 10 * sum / (cnt * Scale)
+            auto const num = 20 * static_cast<int64_t>(sum_) + static_cast<int64_t>(cnt_) * Scale;
+            auto const den = 2 * static_cast<int64_t>(cnt_) * Scale;
+            auto q = num / den;
+            if (num % den < 0)
+                --q;
+            return q;
+        }
+    }
 
-    friend std::ostream &operator<<(std::ostream &o, statistics const &s) {
-        return o << "min: " << s.min_ << " avg: " << s.avg() << " max: " << s.max_ << " cnt: " << s.cnt_;
+    friend std::ostream &operator<<(std::ostream &o, basic_statistics const &s) {
+        return o << "min: " << s.min() << " avg: " << s.avg() << " max: " << s.max() << " cnt: " << s.cnt_;
+    }
+
+    /** a value as integer tenths, rounded half up */
+    static int64_t to_tenths(Value v) noexcept {
+        if constexpr (std::is_floating_point_v<Value>)
+            return static_cast<int64_t>(std::floor(static_cast<double>(v) * 10. / Scale + .5));
+        else
+            return static_cast<int64_t>(v) * 10 / Scale;
     }
 };
 
+/** the original representation: float values, float sum */
+using float_statistics = basic_statistics<float, float, unsigned, 1>;
+/** integer tenths; exact sums and counts for any number of rows of the challenge */
+using fixed_statistics = basic_statistics<int16_t, int64_t, uint64_t, 10>;
+/** integer tenths of 32 bits, for values beyond -3276.8..3276.7 like an air pressure of 1013.25 hPa in Pa */
+using wide_fixed_statistics = basic_statistics<int32_t, int64_t, uint64_t, 10>;
+
+/**
+ * statistics is the representation of the first value column, which is kept
+ * in the station table; column_statistics that of the further value columns
+ * (see station_map), whose values may have a wider range.
+ */
+#ifdef USE_FIXED_POINT_STATISTICS
+using statistics = fixed_statistics;
+using column_statistics = wide_fixed_statistics;
+#else
+using statistics = float_statistics;
+using column_statistics = float_statistics;
+#endif
+
 #endif //STATISTICS_H
@@ -0,0 +1,74 @@
+#include <cstdint>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "statistics.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check fixed_statistics") {
+    SUBCASE("min, max and count") {
+        fixed_statistics s(fixed_statistics::from_tenths(-5));
+        s.add_value(fixed_statistics::from_tenths(999));
+        s.add_value(fixed_statistics::from_tenths(-999));
+        CHECK(s.min() == doctest::Approx(-99.9));
+        CHECK(s.max() == doctest::Approx(99.9));
+        CHECK(s.cnt_ == 3);
+        CHECK(s.sum_ == -5);
+    }
+    SUBCASE("mean is rounded half up") {
+        fixed_statistics s(fixed_statistics::from_tenths(1));
+        s.add_value(fixed_statistics::from_tenths(2)); // 1.5 tenths
+        CHECK(s.avg() == doctest::Approx(0.2));
+        fixed_statistics n(fixed_statistics::from_tenths(-1));
+        n.add_value(fixed_statistics::from_tenths(-2)); // -1.5 tenths
+        CHECK(n.avg() == doctest::Approx(-0.1));
+        n.add_value(fixed_statistics::from_tenths(-2)); // -1.67 tenths
+        CHECK(n.avg() == doctest::Approx(-0.2));
+        fixed_statistics z(fixed_statistics::from_tenths(-1));
+        z.add_value(fixed_statistics::from_tenths(1));
+        CHECK(z.avg() == 0.);
+    }
+    SUBCASE("tenths") {
+        fixed_statistics s(fixed_statistics::from_tenths(-15));
+        s.add_value(fixed_statistics::from_tenths(-14)); // -14.5 tenths
+        CHECK(s.min_tenths() == -15);
+        CHECK(s.max_tenths() == -14);
+        CHECK(s.avg_tenths() == -14);
+        s.add_value(fixed_statistics::from_tenths(999));
+        CHECK(s.avg_tenths() == 323);
+    }
+    SUBCASE("sums do not lose precision") {
+        fixed_statistics s(fixed_statistics::from_tenths(123));
+        for (int i = 1; i < 10'000'000; ++i)
+            s.add_value(fixed_statistics::from_tenths(123));
+        CHECK(s.sum_ == int64_t{123} * 10'000'000);
+        CHECK(s.avg() == doctest::Approx(12.3));
+    }
+    SUBCASE("combine") {
+        fixed_statistics a(*fixed_statistics::from_double(-3.4));
+        fixed_statistics b(*fixed_statistics::from_double(7.8));
+        b.add_value(*fixed_statistics::from_double(0.));
+        a.combine(b);
+        CHECK(a.cnt_ == 3);
+        CHECK(a.min_ == -34);
+        CHECK(a.max_ == 78);
+        CHECK(a.avg() == doctest::Approx(1.5));
+    }
+    SUBCASE("range of decimal values") {
+        CHECK(fixed_statistics::from_double(-12.25) == -123);
+        CHECK(fixed_statistics::from_double(3276.7) == 32767);
+        CHECK_FALSE(fixed_statistics::from_double(3276.8).has_value());
+        CHECK_FALSE(fixed_statistics::from_double(-3276.9).has_value());
+        CHECK_FALSE(fixed_statistics::from_double(1e300).has_value());
+        CHECK(wide_fixed_statistics::from_double(101325.) == 1013250);
+    }
+}
+
+TEST_CASE("Check float_statistics") {
+    float_statistics s(float_statistics::from_tenths(-5));
+    s.add_value(*float_statistics::from_double(2.5));
+    CHECK(s.min() == doctest::Approx(-0.5));
+    CHECK(s.max() == doctest::Approx(2.5));
+    CHECK(s.avg() == doctest::Approx(1.0));
+    CHECK(s.min_tenths() == -5);
+    CHECK(s.max_tenths() == 25);
+    CHECK(s.avg_tenths() == 10);
+}
@@ -0,0 +1,154 @@
+#ifndef STREAM_INPUT_H
+#define STREAM_INPUT_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+#include "bounded_queue.h"
+
+/**
+ * a block of complete lines read from a stream
+ */
+struct stream_block {
+    [[nodiscard]] std::string_view string_view() const { return {buffer_.data(), len_}; }
+
+    std::vector<char> buffer_;
+    size_t len_{0};    // number of valid bytes in buffer_; they always end with a new-line
+    size_t offset_{0}; // offset of buffer_[0] in the stream
+};
+
+/**
+ * reads up to len bytes into buf; returns 0 at the end of the stream
+ */
+using read_function = std::function<size_t(char *buf, size_t len)>;
+
+/**
+ * @return a read_function for a file descriptor; retries on EINTR
+ */
+inline auto fd_read_function(int fd, std::string name) -> read_function {
+    return [fd, name = std::move(name)](char *buf, size_t len) -> size_t {
+        while (true) {
+            auto const n = read(fd, buf, len);
+            if (n >= 0)
+                return static_cast<size_t>(n);
+            if (errno != EINTR) {
+                perror(name.c_str());
+                throw std::runtime_error("READ FAILED");
+            }
+        }
+    };
+}
+
+/**
+ * Reads a stream which need not be seekable (stdin, a pipe, a socket or the
+ * output of a decompressor) in large blocks and passes them to parser threads.
+ *
+ * Every block is cut behind its last new-line; the unfinished line is carried
+ * over to the start of the next block, so each block only contains complete
+ * lines. If the stream does not end with a new-line, one is appended. Parsed
+ * blocks can be handed back via recycle() to avoid allocations.
+ */
+class stream_input {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 22;
+
+    stream_input(read_function source, std::string name, size_t queue_capacity, size_t block_size = DEFAULT_BLOCK_SIZE)
+        : source_{std::move(source)}, name_{std::move(name)}, block_size_{block_size}, full_{queue_capacity}, free_{queue_capacity} {
+    }
+
+    stream_input(int fd, std::string name, size_t queue_capacity, size_t block_size = DEFAULT_BLOCK_SIZE)
+        : stream_input(fd_read_function(fd, name), std::move(name), queue_capacity, block_size) {
+    }
+
+    /**
+     * read the whole stream and push its blocks; closes the queue at the end
+     * or as soon as the consumers close it
+     */
+    void read_all() {
+        try {
+            read_blocks();
+        } catch (...) {
+            full_.close();
+            throw;
+        }
+        full_.close();
+    }
+
+    /**
+     * @return the next block or an empty optional at the end of the stream
+     */
+    std::optional<stream_block> next() { return full_.pop(); }
+
+    void recycle(stream_block block) { free_.try_push(std::move(block)); }
+
+    /**
+     * stop reading, e.g. because a consumer failed
+     */
+    void cancel() { full_.close(); }
+
+    [[nodiscard]] std::string const & name() const noexcept { return name_; }
+
+private:
+    void read_blocks() {
+        std::vector<char> carry;
+        size_t offset = 0;
+        bool eof = false;
+        while (!eof) {
+            auto block = free_.try_pop().value_or(stream_block{});
+            block.buffer_.resize(std::max({block.buffer_.size(), block_size_, 2 * carry.size()}));
+            std::copy(carry.begin(), carry.end(), block.buffer_.begin());
+            size_t filled = carry.size();
+            size_t last_nl = std::string_view::npos;
+            while (true) {
+                eof = !fill(block.buffer_, filled);
+                last_nl = std::string_view(block.buffer_.data(), filled).rfind('\n');
+                if (eof || last_nl != std::string_view::npos)
+                    break;
+                // a line longer than the block: enlarge it
+                block.buffer_.resize(2 * block.buffer_.size());
+            }
+            if (eof && filled > 0 && (last_nl == std::string_view::npos || last_nl + 1 < filled)) {
+                if (filled == block.buffer_.size())
+                    block.buffer_.resize(filled + 1);
+                block.buffer_[filled++] = '\n';
+                last_nl = filled - 1;
+            }
+            size_t const len = last_nl == std::string_view::npos ? 0 : last_nl + 1;
+            carry.assign(block.buffer_.begin() + static_cast<std::ptrdiff_t>(len), block.buffer_.begin() + static_cast<std::ptrdiff_t>(filled));
+            block.len_ = len;
+            block.offset_ = offset;
+            offset += len;
+            if (len > 0 && !full_.push(std::move(block)))
+                return;
+        }
+    }
+
+    /**
+     * read from the stream until buffer is full
+     * @return false at the end of the stream
+     */
+    bool fill(std::vector<char> & buffer, size_t & filled) {
+        while (filled < buffer.size()) {
+            auto const n = source_(buffer.data() + filled, buffer.size() - filled);
+            if (n == 0)
+                return false;
+            filled += n;
+        }
+        return true;
+    }
+
+    read_function source_;
+    std::string name_;
+    size_t block_size_;
+    bounded_queue<stream_block> full_;
+    bounded_queue<stream_block> free_;
+};
+
+#endif //STREAM_INPUT_H
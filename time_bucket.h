@@ -0,0 +1,206 @@
+#ifndef TIME_BUCKET_H
+#define TIME_BUCKET_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * Aggregation per station and time bucket (--group-by): every line starts
+ * with a timestamp, TIMESTAMP;STATION;VALUE[;VALUE...], and the values are
+ * aggregated per station and hour or day of the timestamp (UTC).
+ *
+ * The table key of such a line is the station name followed by the index of
+ * the bucket (see grouped_key), so the station table, its merging and
+ * everything built on it work unchanged for the composite keys.
+ */
+enum class time_bucket {
+    hour,
+    day
+};
+
+inline auto parse_time_bucket(std::string_view name) -> std::optional<time_bucket> {
+    if (name == "hour")
+        return time_bucket::hour;
+    if (name == "day")
+        return time_bucket::day;
+    return {};
+}
+
+inline constexpr std::string_view time_bucket_name(time_bucket bucket) noexcept {
+    return bucket == time_bucket::hour ? "hour" : "day";
+}
+
+inline constexpr int64_t bucket_seconds(time_bucket bucket) noexcept {
+    return bucket == time_bucket::hour ? 3600 : 86400;
+}
+
+/**
+ * @return the index of the bucket holding the given seconds since the epoch,
+ * i.e. the number of buckets since the epoch rounded down, if it fits
+ */
+inline auto bucket_index(int64_t seconds, time_bucket bucket) noexcept -> std::optional<int32_t> {
+    auto const size = bucket_seconds(bucket);
+    auto index = seconds / size;
+    if (seconds % size < 0)
+        --index;
+    if (index < std::numeric_limits<int32_t>::min() || index > std::numeric_limits<int32_t>::max())
+        return {};
+    return static_cast<int32_t>(index);
+}
+
+/**
+ * days since 1970-01-01 of a date of the proleptic Gregorian calendar
+ * (H. Hinnant, chrono-compatible low-level date algorithms)
+ */
+inline constexpr int64_t days_from_civil(int64_t y, unsigned m, unsigned d) noexcept {
+    y -= m <= 2;
+    int64_t const era = (y >= 0 ? y : y - 399) / 400;
+    auto const yoe = static_cast<unsigned>(y - era * 400);
+    unsigned const doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+struct civil_date {
+    int64_t year_;
+    unsigned month_;
+    unsigned day_;
+};
+
+/**
+ * the inverse of days_from_civil
+ */
+inline constexpr civil_date civil_from_days(int64_t days) noexcept {
+    days += 719468;
+    int64_t const era = (days >= 0 ? days : days - 146096) / 146097;
+    auto const doe = static_cast<unsigned>(days - era * 146097);
+    unsigned const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned const doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned const mp = (5 * doy + 2) / 153;
+    unsigned const d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned const m = mp < 10 ? mp + 3 : mp - 9;
+    return {static_cast<int64_t>(yoe) + era * 400 + (m <= 2), m, d};
+}
+
+namespace timestamp_detail {
+
+/**
+ * @return the n digits at p as a number; sets bad if one of them is no digit
+ */
+inline unsigned digits(char const * p, size_t n, unsigned & bad) noexcept {
+    unsigned v = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto const digit = static_cast<unsigned>(static_cast<unsigned char>(p[i])) - '0';
+        bad |= digit > 9;
+        v = v * 10 + digit;
+    }
+    return v;
+}
+
+inline bool is_digit(char c) noexcept {
+    return static_cast<unsigned>(static_cast<unsigned char>(c)) - '0' <= 9;
+}
+
+} // namespace timestamp_detail
+
+/**
+ * Parse a timestamp of the fixed format
+ *
+ *     YYYY-MM-DDThh:mm:ss[.fraction][Z|+hh:mm|-hh:mm]   (or a space instead of the T)
+ *
+ * or an integer number of seconds since the epoch, e.g. 1714571100. The
+ * fields are read at their fixed positions without any locale or time zone
+ * database; without Z or an offset the time is taken as UTC. Fractions of
+ * seconds are ignored.
+ *
+ * @return seconds since 1970-01-01T00:00:00Z or nothing if sv has another format
+ */
+inline auto parse_timestamp(std::string_view sv) noexcept -> std::optional<int64_t> {
+    using namespace timestamp_detail;
+    char const * p = sv.data();
+    size_t const n = sv.size();
+    if (n < 19 || p[4] != '-') {
+        // seconds since the epoch
+        size_t i = n > 0 && p[0] == '-' ? 1 : 0;
+        if (i == n || n - i > 18)
+            return {};
+        int64_t seconds = 0;
+        for (; i < n; ++i) {
+            if (!is_digit(p[i]))
+                return {};
+            seconds = seconds * 10 + (p[i] - '0');
+        }
+        return p[0] == '-' ? -seconds : seconds;
+    }
+    unsigned bad = 0;
+    auto const year = digits(p, 4, bad);
+    auto const month = digits(p + 5, 2, bad);
+    auto const day = digits(p + 8, 2, bad);
+    auto const hour = digits(p + 11, 2, bad);
+    auto const minute = digits(p + 14, 2, bad);
+    auto const second = digits(p + 17, 2, bad);
+    static constexpr unsigned char days_in_month[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (bad || p[7] != '-' || (p[10] != 'T' && p[10] != ' ') || p[13] != ':' || p[16] != ':'
+        || month - 1 > 11 || day - 1 >= days_in_month[(month - 1) % 12] || hour > 23 || minute > 59 || second > 60)
+        return {};
+    if (month == 2 && day == 29 && (year % 4 != 0 || (year % 100 == 0 && year % 400 != 0)))
+        return {};
+    int64_t seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    size_t i = 19;
+    if (i < n && p[i] == '.') {
+        size_t const fraction = ++i;
+        while (i < n && is_digit(p[i]))
+            ++i;
+        if (i == fraction)
+            return {};
+    }
+    if (i == n)
+        return seconds;
+    if (p[i] == 'Z' && i + 1 == n)
+        return seconds;
+    if ((p[i] == '+' || p[i] == '-') && i + 6 == n && p[i + 3] == ':') {
+        auto const offset_hours = digits(p + i + 1, 2, bad);
+        auto const offset_minutes = digits(p + i + 4, 2, bad);
+        if (bad || offset_hours > 23 || offset_minutes > 59)
+            return {};
+        auto const offset = static_cast<int64_t>(offset_hours * 3600 + offset_minutes * 60);
+        return p[i] == '+' ? seconds - offset : seconds + offset;
+    }
+    return {};
+}
+
+/**
+ * The table key of a station in a time bucket: the name followed by
+ * BUCKET_SIZE bytes of the bucket index.
+ */
+namespace grouped_key {
+
+static constexpr size_t BUCKET_SIZE = sizeof(int32_t);
+
+/**
+ * replace key by the key of station in bucket
+ */
+inline void assign(std::string & key, std::string_view station, int32_t bucket) {
+    key.assign(station);
+    char bytes[BUCKET_SIZE];
+    std::memcpy(bytes, &bucket, BUCKET_SIZE);
+    key.append(bytes, BUCKET_SIZE);
+}
+
+[[nodiscard]] inline std::string_view station(std::string_view key) noexcept {
+    return key.substr(0, key.size() - BUCKET_SIZE);
+}
+
+[[nodiscard]] inline int32_t bucket(std::string_view key) noexcept {
+    int32_t bucket;
+    std::memcpy(&bucket, key.data() + key.size() - BUCKET_SIZE, BUCKET_SIZE);
+    return bucket;
+}
+
+} // namespace grouped_key
+
+#endif //TIME_BUCKET_H
@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <string>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "time_bucket.h"
+#include <doctest/doctest.h>
+
+TEST_CASE("Check timestamp parsing") {
+    CHECK(parse_timestamp("1970-01-01T00:00:00") == 0);
+    CHECK(parse_timestamp("2024-05-01T13:45:00Z") == 1714571100);
+    CHECK(parse_timestamp("2024-05-01 13:45:00") == 1714571100);
+    CHECK(parse_timestamp("2024-05-01T13:45:00.250Z") == 1714571100);
+    CHECK(parse_timestamp("2024-05-01T15:45:00+02:00") == 1714571100);
+    CHECK(parse_timestamp("2024-05-01T10:15:00-03:30") == 1714571100);
+    CHECK(parse_timestamp("2024-02-29T00:00:00") == 1709164800);
+    CHECK(parse_timestamp("1969-12-31T23:59:59") == -1);
+    CHECK(parse_timestamp("1714571100") == 1714571100);
+    CHECK(parse_timestamp("-1") == -1);
+    CHECK(parse_timestamp("0") == 0);
+
+    CHECK_FALSE(parse_timestamp(""));
+    CHECK_FALSE(parse_timestamp("-"));
+    CHECK_FALSE(parse_timestamp("17145x1100"));
+    CHECK_FALSE(parse_timestamp("2024-05-01"));
+    CHECK_FALSE(parse_timestamp("2024-05-01T13:45"));
+    CHECK_FALSE(parse_timestamp("2024-13-01T00:00:00"));
+    CHECK_FALSE(parse_timestamp("2024-00-01T00:00:00"));
+    CHECK_FALSE(parse_timestamp("2023-02-29T00:00:00"));
+    CHECK_FALSE(parse_timestamp("2024-04-31T00:00:00"));
+    CHECK_FALSE(parse_timestamp("2024-05-01T24:00:00"));
+    CHECK_FALSE(parse_timestamp("2024-05-01T13:45:00."));
+    CHECK_FALSE(parse_timestamp("2024-05-01T13:45:00ZZ"));
+    CHECK_FALSE(parse_timestamp("2024-05-01T13:45:00+0200"));
+    CHECK_FALSE(parse_timestamp("2024/05/01T13:45:00"));
+}
+
+TEST_CASE("Check civil dates") {
+    CHECK(days_from_civil(1970, 1, 1) == 0);
+    CHECK(days_from_civil(2000, 3, 1) == 11017);
+    CHECK(days_from_civil(1969, 12, 31) == -1);
+    for (int64_t days : {-719468, -1, 0, 11016, 11017, 19844, 2932896}) {
+        auto const date = civil_from_days(days);
+        CHECK(days_from_civil(date.year_, date.month_, date.day_) == days);
+    }
+    auto const date = civil_from_days(19844);
+    CHECK(date.year_ == 2024);
+    CHECK(date.month_ == 5);
+    CHECK(date.day_ == 1);
+}
+
+TEST_CASE("Check time buckets") {
+    CHECK(parse_time_bucket("hour") == time_bucket::hour);
+    CHECK(parse_time_bucket("day") == time_bucket::day);
+    CHECK_FALSE(parse_time_bucket("week"));
+    CHECK(bucket_index(1714571100, time_bucket::hour) == 476269);
+    CHECK(bucket_index(1714571100, time_bucket::day) == 19844);
+    CHECK(bucket_index(-1, time_bucket::day) == -1);
+    CHECK(bucket_index(-86400, time_bucket::day) == -1);
+    CHECK_FALSE(bucket_index(int64_t{1} << 62, time_bucket::hour));
+
+    std::string key;
+    grouped_key::assign(key, "Abha", -5);
+    CHECK(key.size() == 4 + grouped_key::BUCKET_SIZE);
+    CHECK(grouped_key::station(key) == "Abha");
+    CHECK(grouped_key::bucket(key) == -5);
+    grouped_key::assign(key, "", 476269);
+    CHECK(grouped_key::station(key).empty());
+    CHECK(grouped_key::bucket(key) == 476269);
+}
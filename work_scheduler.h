@@ -0,0 +1,75 @@
+#ifndef WORK_SCHEDULER_H
+#define WORK_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+/**
+ * Hands out consecutive ranges of a file to worker threads.
+ *
+ * Instead of assigning one large partition per thread up front, every worker
+ * claims the next small range from a shared atomic cursor whenever it has
+ * finished the previous one. Thus a slow core or a region of cold pages only
+ * delays the ranges this worker happens to process, all other workers keep
+ * pulling from the cursor until the whole file is done.
+ *
+ * The range boundaries do not respect lines; scan_input() skips the partial
+ * line at the start of a range and finishes the line crossing its end.
+ */
+class work_scheduler {
+public:
+    struct range {
+        size_t start_;
+        size_t end_;
+        size_t nr_;
+    };
+
+    /**
+     * @param begin offset of the first byte to process
+     * @param end offset behind the last byte to process
+     * @param range_size size of the ranges handed out; rounded up to a multiple of alignment
+     * @param alignment ranges start at begin + a multiple of alignment (e.g. the page size)
+     */
+    work_scheduler(size_t begin, size_t end, size_t range_size, size_t alignment = 1) noexcept
+        : begin_{begin}, end_{std::max(begin, end)},
+          range_size_{std::max(alignment, (range_size + alignment - 1) / alignment * alignment)} {
+    }
+
+    work_scheduler(work_scheduler const &) = delete;
+    work_scheduler &operator=(work_scheduler const &) = delete;
+
+    /**
+     * @return the next unprocessed range or an empty optional if all ranges are handed out
+     */
+    [[nodiscard]] std::optional<range> next() noexcept {
+        size_t const nr = cursor_.fetch_add(1, std::memory_order_relaxed);
+        if (nr >= ranges_total())
+            return {};
+        size_t const start = begin_ + nr * range_size_;
+        return range{start, std::min(start + range_size_, end_), nr};
+    }
+
+    [[nodiscard]] size_t range_size() const noexcept { return range_size_; }
+
+    [[nodiscard]] size_t ranges_total() const noexcept { return (end_ - begin_ + range_size_ - 1) / range_size_; }
+
+    /**
+     * A range size which yields about ranges_per_thread ranges per thread, but
+     * at least min_size and at most max_size bytes.
+     */
+    static size_t suggest_range_size(size_t bytes, size_t threads, size_t min_size, size_t max_size,
+                                     size_t ranges_per_thread = 16) noexcept {
+        size_t const ranges = std::max<size_t>(1, threads * ranges_per_thread);
+        return std::clamp((bytes + ranges - 1) / ranges, min_size, std::max(min_size, max_size));
+    }
+
+private:
+    size_t const begin_;
+    size_t const end_;
+    size_t const range_size_;
+    std::atomic<size_t> cursor_{0};
+};
+
+#endif //WORK_SCHEDULER_H